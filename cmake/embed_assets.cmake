@@ -0,0 +1,38 @@
+# 把资源文件转换成C++字节数组，构建时由src/CMakeLists.txt调用：
+# cmake -DASSET_ROOT=<dir> -DASSETS=<a|b> -DOUTPUT=<file> -P embed_assets.cmake
+# ASSETS are paths relative to ASSET_ROOT, separated by "|", and are also the
+# names passed to OpenAsset.
+string(REPLACE "|" ";" asset_list "${ASSETS}")
+
+set(content "// Generated by cmake/embed_assets.cmake, do not edit\n")
+string(APPEND content "#include \"assets.h\"\n\n")
+set(table "")
+# 每行16个字节，CMake的正则不支持{n}
+set(byte_pattern "")
+foreach(i RANGE 1 16)
+    string(APPEND byte_pattern "0x..,")
+endforeach()
+set(index 0)
+foreach(asset IN LISTS asset_list)
+    file(READ "${ASSET_ROOT}/${asset}" hex HEX)
+    string(LENGTH "${hex}" hex_length)
+    math(EXPR size "${hex_length} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+    string(REGEX REPLACE "(${byte_pattern})" "\\1\n" bytes "${bytes}")
+    string(APPEND content
+        "static const unsigned char kAsset${index}[] = {\n${bytes}\n};\n\n")
+    string(APPEND table "    {\"${asset}\", kAsset${index}, ${size}},\n")
+    math(EXPR index "${index} + 1")
+endforeach()
+string(APPEND content
+    "const EmbeddedAsset kEmbeddedAssets[] = {\n${table}};\n\n")
+string(APPEND content "const size_t kEmbeddedAssetCount = ${index};\n")
+
+# 内容不变时不改动文件，避免重新编译
+if(EXISTS "${OUTPUT}")
+    file(READ "${OUTPUT}" old_content)
+    if(old_content STREQUAL content)
+        return()
+    endif()
+endif()
+file(WRITE "${OUTPUT}" "${content}")
@@ -0,0 +1,69 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace {
+
+std::atomic<Uint64> allocation_count{0};
+
+void *Allocate(size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  void *p = std::malloc(size == 0 ? 1 : size);
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *AllocateAligned(size_t size, std::align_val_t alignment) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  const size_t a = static_cast<size_t>(alignment);
+#ifdef _WIN32
+  void *p = _aligned_malloc(size == 0 ? 1 : size, a);
+#else
+  // aligned_alloc要求大小是对齐的整数倍
+  void *p = std::aligned_alloc(a, size == 0 ? a : (size + a - 1) / a * a);
+#endif
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void FreeAligned(void *p) {
+#ifdef _WIN32
+  _aligned_free(p);
+#else
+  std::free(p);
+#endif
+}
+
+}  // namespace
+
+Uint64 GetAllocationCount() {
+  return allocation_count.load(std::memory_order_relaxed);
+}
+
+// 数组、nothrow和带大小的版本默认都转发到下面这几个
+void *operator new(size_t size) { return Allocate(size); }
+
+void *operator new(size_t size, std::align_val_t alignment) {
+  return AllocateAligned(size, alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+
+void operator delete(void *p, std::align_val_t) noexcept { FreeAligned(p); }
+
+// 编译器会直接调用带大小的版本，也一起替换，所有释放都经过这个文件
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  FreeAligned(p);
+}
@@ -0,0 +1,9 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+// 统计全局operator new的调用次数，用来检查稳态的游戏帧不分配堆内存
+// Only executables that link allocation_counter.cpp count, because that file
+// replaces the global operator new and delete. Allocations on every thread
+// are counted. SDL and other C libraries use malloc and are not seen.
+Uint64 GetAllocationCount();
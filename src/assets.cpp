@@ -0,0 +1,29 @@
+#include "assets.h"
+
+#include <cstring>
+#include <string>
+
+SDL_RWops *OpenAsset(const char *path) {
+#ifdef HAKUSYU_EMBED_ASSETS
+  for (size_t i = 0; i < kEmbeddedAssetCount; i++) {
+    const EmbeddedAsset &asset = kEmbeddedAssets[i];
+    if (std::strcmp(asset.path, path) == 0) {
+      return SDL_RWFromConstMem(asset.data, static_cast<int>(asset.size));
+    }
+  }
+  SDL_SetError("Asset %s is not embedded", path);
+  return nullptr;
+#else
+  // 构建时资源被复制到可执行文件旁边，不依赖启动时的工作目录
+  char *base_path = SDL_GetBasePath();
+  if (base_path != nullptr) {
+    const std::string full_path = std::string(base_path) + path;
+    SDL_free(base_path);
+    SDL_RWops *file = SDL_RWFromFile(full_path.c_str(), "rb");
+    if (file != nullptr) {
+      return file;
+    }
+  }
+  return SDL_RWFromFile(path, "rb");
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <cstddef>
+
+// 图片和字体的统一入口
+// With HAKUSYU_EMBED_ASSETS the bytes are compiled into the executable and
+// no file is touched. Otherwise path is tried next to the executable first,
+// then relative to the working directory. Returns nullptr and sets the SDL
+// error when the asset does not exist.
+SDL_RWops *OpenAsset(const char *path);
+
+#ifdef HAKUSYU_EMBED_ASSETS
+struct EmbeddedAsset {
+  const char *path;
+  const unsigned char *data;
+  size_t size;
+};
+
+// Generated by cmake/embed_assets.cmake
+extern const EmbeddedAsset kEmbeddedAssets[];
+extern const size_t kEmbeddedAssetCount;
+#endif
@@ -0,0 +1,246 @@
+#include "audio_source.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#include "game_error.h"
+
+constexpr int kSyntheticSampleRate = 44100;
+constexpr int kSyntheticChannels = 2;
+constexpr float kSyntheticNoiseAmplitude = 1000.0f;
+constexpr float kSyntheticFloorAmplitude = 100.0f;
+constexpr float kSyntheticClapAmplitude = 20000.0f;
+constexpr float kSyntheticClapDecay = 0.02f;
+constexpr float kSyntheticClapLength = 0.1f;
+
+namespace {
+
+Uint16 ReadLE16(const unsigned char *p) {
+  return static_cast<Uint16>(p[0] | (p[1] << 8));
+}
+
+Uint32 ReadLE32(const unsigned char *p) {
+  return static_cast<Uint32>(p[0]) | (static_cast<Uint32>(p[1]) << 8) |
+         (static_cast<Uint32>(p[2]) << 16) | (static_cast<Uint32>(p[3]) << 24);
+}
+
+}  // namespace
+
+MicrophoneSource::MicrophoneSource(int device_index)
+    : device_index_(device_index) {}
+
+MicrophoneSource::~MicrophoneSource() { Close(); }
+
+void MicrophoneSource::Open(int frames, SDL_AudioSpec *spec) {
+  SDL_AudioSpec desired_audio_spec;
+  SDL_zero(desired_audio_spec);
+  // following is recommended arguments for most platforms
+  desired_audio_spec.freq = 44100;
+  desired_audio_spec.format = AUDIO_S16;
+  desired_audio_spec.channels = 2;
+  desired_audio_spec.samples = static_cast<Uint16>(frames);
+  desired_audio_spec.callback = AudioCallback_;
+  desired_audio_spec.userdata = this;
+  id_ = SDL_OpenAudioDevice(
+      SDL_GetAudioDeviceName(device_index_, SDL_TRUE), SDL_TRUE,
+      &desired_audio_spec, spec,
+      SDL_AUDIO_ALLOW_ANY_CHANGE & ~SDL_AUDIO_ALLOW_FORMAT_CHANGE);
+  if (id_ == 0) {
+    throw GameError(SDL_GetError());
+  }
+}
+
+void MicrophoneSource::Start(AudioSink sink, void *userdata) {
+  // 设备打开后一直处于暂停状态，回调还没有读取这两个成员
+  sink_ = sink;
+  sink_userdata_ = userdata;
+  SDL_PauseAudioDevice(id_, SDL_FALSE);
+}
+
+void MicrophoneSource::Close() {
+  if (id_ != 0) {
+    SDL_CloseAudioDevice(id_);
+    id_ = 0;
+  }
+}
+
+void MicrophoneSource::AudioCallback_(void *userdata, Uint8 *stream,
+                                      int len) {
+  auto source = static_cast<MicrophoneSource *>(userdata);
+  source->sink_(source->sink_userdata_, stream, len);
+}
+
+StreamingSource::StreamingSource(float speed) : speed_(speed) {}
+
+StreamingSource::~StreamingSource() { Close(); }
+
+void StreamingSource::Open(int frames, SDL_AudioSpec *spec) {
+  frames_ = std::max(frames, 1);
+  SDL_zerop(spec);
+  spec->freq = sample_rate_;
+  spec->format = AUDIO_S16;
+  spec->channels = static_cast<Uint8>(channels_);
+  spec->samples = static_cast<Uint16>(frames_);
+}
+
+void StreamingSource::Start(AudioSink sink, void *userdata) {
+  clock_.Reset(sample_rate_);
+  running_.store(true, std::memory_order_relaxed);
+  thread_ = std::thread(&StreamingSource::Run, this, sink, userdata);
+}
+
+void StreamingSource::Close() {
+  running_.store(false, std::memory_order_relaxed);
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+Clock *StreamingSource::GetStreamClock() {
+  return speed_ == 1.0f ? nullptr : &clock_;
+}
+
+void StreamingSource::SetFormat(int sample_rate, int channels) {
+  sample_rate_ = sample_rate;
+  channels_ = channels;
+}
+
+int StreamingSource::GetChannels() const { return channels_; }
+
+void StreamingSource::Run(AudioSink sink, void *userdata) {
+  using SteadyClock = std::chrono::steady_clock;
+  const SteadyClock::time_point start = SteadyClock::now();
+  Uint64 delivered_frames = 0;
+  while (running_.load(std::memory_order_relaxed)) {
+    int frames_read = 0;
+    const Sint16 *samples = Read(frames_, &frames_read);
+    if (samples == nullptr) {
+      break;
+    }
+    sink(userdata, reinterpret_cast<const Uint8 *>(samples),
+         frames_read * channels_ * static_cast<int>(sizeof(Sint16)));
+    delivered_frames += frames_read;
+    clock_.AddFrames(frames_read);
+    if (speed_ > 0) {
+      // 按累计的帧数计算下一块的时刻，睡眠误差不会累积
+      const double seconds =
+          static_cast<double>(delivered_frames) / sample_rate_ / speed_;
+      std::this_thread::sleep_until(
+          start + std::chrono::duration_cast<SteadyClock::duration>(
+                      std::chrono::duration<double>(seconds)));
+    }
+  }
+}
+
+WavFileSource::WavFileSource(const char *path, float speed, bool loop)
+    : StreamingSource(speed), loop_(loop) {
+  file_.Open(path);
+  const unsigned char *data = file_.GetData();
+  const size_t size = file_.GetSize();
+  if (size < 12 || std::memcmp(data, "RIFF", 4) != 0 ||
+      std::memcmp(data + 8, "WAVE", 4) != 0) {
+    throw GameError("Not a WAV file");
+  }
+  int sample_rate = 0;
+  int channels = 0;
+  int bits_per_sample = 0;
+  size_t offset = 12;
+  while (offset + 8 <= size) {
+    const unsigned char *chunk = data + offset;
+    const size_t chunk_size = ReadLE32(chunk + 4);
+    const size_t body = offset + 8;
+    if (std::memcmp(chunk, "fmt ", 4) == 0 && chunk_size >= 16 &&
+        body + 16 <= size) {
+      const Uint16 format = ReadLE16(data + body);
+      // 1是PCM，0xFFFE是WAVE_FORMAT_EXTENSIBLE，子格式的前两个字节同样是1
+      const bool is_pcm =
+          format == 1 || (format == 0xFFFE && chunk_size >= 26 &&
+                          body + 26 <= size && ReadLE16(data + body + 24) == 1);
+      if (!is_pcm) {
+        throw GameError("Only PCM WAV files are supported");
+      }
+      channels = ReadLE16(data + body + 2);
+      sample_rate = static_cast<int>(ReadLE32(data + body + 4));
+      bits_per_sample = ReadLE16(data + body + 14);
+    } else if (std::memcmp(chunk, "data", 4) == 0) {
+      if (bits_per_sample != 16 || channels <= 0 || sample_rate <= 0) {
+        throw GameError("Only 16-bit PCM WAV files are supported");
+      }
+      if (body % alignof(Sint16) != 0) {
+        throw GameError("Misaligned WAV data chunk");
+      }
+      // 录制中断的文件data长度可能超过实际大小
+      const size_t bytes = std::min(chunk_size, size - body);
+      samples_ = reinterpret_cast<const Sint16 *>(data + body);
+      frame_count_ = bytes / (channels * sizeof(Sint16));
+      break;
+    }
+    // 块按偶数字节对齐
+    offset = body + chunk_size + (chunk_size & 1);
+  }
+  if (samples_ == nullptr || frame_count_ == 0) {
+    throw GameError("WAV file has no audio data");
+  }
+  SetFormat(sample_rate, channels);
+}
+
+WavFileSource::~WavFileSource() { Close(); }
+
+const Sint16 *WavFileSource::Read(int frames, int *frames_read) {
+  if (position_ == frame_count_) {
+    if (!loop_) {
+      return nullptr;
+    }
+    position_ = 0;
+  }
+  const size_t n =
+      std::min(static_cast<size_t>(frames), frame_count_ - position_);
+  const Sint16 *result = samples_ + position_ * GetChannels();
+  position_ += n;
+  *frames_read = static_cast<int>(n);
+  return result;
+}
+
+SyntheticSource::SyntheticSource(SyntheticSignal signal, float speed,
+                                 unsigned int seed)
+    : StreamingSource(speed), signal_(signal), rng_(seed) {
+  SetFormat(kSyntheticSampleRate, kSyntheticChannels);
+}
+
+SyntheticSource::~SyntheticSource() { Close(); }
+
+const Sint16 *SyntheticSource::Read(int frames, int *frames_read) {
+  chunk_.resize(static_cast<size_t>(frames) * kSyntheticChannels);
+  std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+  const int clap_frames =
+      static_cast<int>(kSyntheticClapLength * kSyntheticSampleRate);
+  for (int i = 0; i < frames; i++, frame_++) {
+    float amplitude = 0.0f;
+    switch (signal_) {
+      case SyntheticSignal::kSilence:
+        break;
+      case SyntheticSignal::kNoise:
+        amplitude = kSyntheticNoiseAmplitude;
+        break;
+      case SyntheticSignal::kClaps: {
+        const int t = static_cast<int>(frame_ % kSyntheticSampleRate);
+        amplitude = kSyntheticFloorAmplitude;
+        if (t < clap_frames) {
+          amplitude += kSyntheticClapAmplitude *
+                       std::exp(-static_cast<float>(t) / kSyntheticSampleRate /
+                                kSyntheticClapDecay);
+        }
+        break;
+      }
+    }
+    for (int c = 0; c < kSyntheticChannels; c++) {
+      chunk_[i * kSyntheticChannels + c] =
+          amplitude == 0.0f ? 0
+                            : static_cast<Sint16>(amplitude * noise(rng_));
+    }
+  }
+  *frames_read = frames;
+  return chunk_.data();
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+#include <memory>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "clock.h"
+#include "mapped_file.h"
+
+// Receives interleaved S16 audio on the source's delivery thread
+using AudioSink = void (*)(void *userdata, const Uint8 *stream, int len);
+
+// Recorder的输入源：麦克风、WAV文件或者合成信号
+class AudioSource {
+ public:
+  virtual ~AudioSource() = default;
+  // Prepares the source for chunks of about frames frames and reports the
+  // actual format in spec, always AUDIO_S16. Nothing is delivered yet.
+  // Throws GameError on failure.
+  virtual void Open(int frames, SDL_AudioSpec *spec) = 0;
+  // Starts calling sink. The receiver must be fully initialized by now.
+  virtual void Start(AudioSink sink, void *userdata) = 0;
+  // No call of sink happens after Close returns
+  virtual void Close() = 0;
+  // Time of the audio delivered so far, for sources that do not play in real
+  // time. nullptr for real-time sources.
+  virtual Clock *GetStreamClock() { return nullptr; }
+};
+
+class MicrophoneSource : public AudioSource {
+ public:
+  explicit MicrophoneSource(int device_index);
+  ~MicrophoneSource() override;
+  void Open(int frames, SDL_AudioSpec *spec) override;
+  void Start(AudioSink sink, void *userdata) override;
+  void Close() override;
+
+ private:
+  static void AudioCallback_(void *userdata, Uint8 *stream, int len);
+
+  int device_index_;
+  SDL_AudioDeviceID id_ = 0;
+  AudioSink sink_ = nullptr;
+  void *sink_userdata_ = nullptr;
+};
+
+// 在自己的线程上按倍速推送数据的音频源
+// speed 1 plays in real time, 2 twice as fast, 0 as fast as the receiver can
+// take it.
+class StreamingSource : public AudioSource {
+ public:
+  explicit StreamingSource(float speed);
+  // Derived classes must call Close in their destructor, the thread reads
+  // their members
+  ~StreamingSource() override;
+  void Open(int frames, SDL_AudioSpec *spec) override;
+  void Start(AudioSink sink, void *userdata) override;
+  void Close() override;
+  // Non-null unless speed is 1
+  Clock *GetStreamClock() override;
+
+ protected:
+  // Derived constructors must set the format before Open
+  void SetFormat(int sample_rate, int channels);
+  int GetChannels() const;
+  // Returns up to frames interleaved frames and their count in frames_read,
+  // or nullptr once the stream has ended. The pointer stays valid until the
+  // next call.
+  virtual const Sint16 *Read(int frames, int *frames_read) = 0;
+
+ private:
+  void Run(AudioSink sink, void *userdata);
+
+  float speed_;
+  int frames_ = 0;
+  int sample_rate_ = 0;
+  int channels_ = 0;
+  StreamClock clock_;
+  std::thread thread_;
+  std::atomic<bool> running_{false};
+};
+
+// 内存映射的WAV文件，Read直接返回映射内的指针，不做拷贝
+class WavFileSource : public StreamingSource {
+ public:
+  // Only 16-bit PCM is accepted. Throws GameError on anything else.
+  WavFileSource(const char *path, float speed, bool loop);
+  ~WavFileSource() override;
+
+ protected:
+  const Sint16 *Read(int frames, int *frames_read) override;
+
+ private:
+  MappedFile file_;
+  const Sint16 *samples_ = nullptr;
+  size_t frame_count_ = 0;
+  size_t position_ = 0;
+  bool loop_;
+};
+
+enum class SyntheticSignal {
+  kSilence,
+  kNoise,
+  // Decaying noise bursts once a second over a quiet noise floor
+  kClaps,
+};
+
+class SyntheticSource : public StreamingSource {
+ public:
+  SyntheticSource(SyntheticSignal signal, float speed, unsigned int seed);
+  ~SyntheticSource() override;
+
+ protected:
+  const Sint16 *Read(int frames, int *frames_read) override;
+
+ private:
+  SyntheticSignal signal_;
+  std::mt19937 rng_;
+  std::vector<Sint16> chunk_;
+  Uint64 frame_ = 0;
+};
@@ -0,0 +1,97 @@
+#include "band_analyzer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+constexpr double kPi = 3.14159265358979323846;
+
+void BandAnalyzer::Init(int sample_rate, const BandConfig &config,
+                        SimdLevel simd) {
+  sample_rate_ = sample_rate;
+  fft_.Init(config.fft_size, simd);
+  const int size = fft_.GetSize();
+  const int m = size / 2;
+  hop_ = m;
+
+  // 周期汉宁窗，50%重叠时各段的权重加起来是常数
+  window_.assign(size, 0.0f);
+  double window_power = 0.0;
+  for (int n = 0; n < size; n++) {
+    window_[n] = static_cast<float>(0.5 - 0.5 * std::cos(2.0 * kPi * n / size));
+    window_power += static_cast<double>(window_[n]) * window_[n];
+  }
+  window_power_ = static_cast<float>(window_power);
+  history_.assign(size, 0.0f);
+  pending_ = 0;
+  input_.assign(size, 0.0f);
+  power_.assign(m + 1, 0.0f);
+
+  // 以奈奎斯特频率为上界的倍频程，低频的频点太少时每个频带至少一个频点
+  band_bins_[0] = 0;
+  band_bins_[kBandCount] = m + 1;
+  for (int b = 1; b < kBandCount; b++) {
+    band_bins_[b] = std::max(m >> (kBandCount - b), band_bins_[b - 1] + 1);
+  }
+  const float bin_hz = static_cast<float>(sample_rate) / size;
+  clap_first_bin_ = std::clamp(
+      static_cast<int>(std::ceil(config.clap_low_hz / bin_hz)), 1, m);
+  clap_end_bin_ = std::clamp(
+      static_cast<int>(std::floor(config.clap_high_hz / bin_hz)) + 1,
+      clap_first_bin_ + 1, m + 1);
+
+  clap_level_ = 0.0f;
+  for (std::atomic<float> &level : band_levels_) {
+    level.store(0.0f, std::memory_order_relaxed);
+  }
+}
+
+void BandAnalyzer::Process(const float *samples, size_t sample_count,
+                           float *clap_levels) {
+  const int size = fft_.GetSize();
+  for (size_t i = 0; i < sample_count; i++) {
+    history_[size - hop_ + pending_] = samples[i];
+    if (++pending_ == hop_) {
+      Analyze();
+      std::memmove(history_.data(), history_.data() + hop_,
+                   (size - hop_) * sizeof(float));
+      pending_ = 0;
+    }
+    clap_levels[i] = clap_level_;
+  }
+}
+
+float BandAnalyzer::GetBandLevel(int band) const {
+  return band_levels_[band].load(std::memory_order_relaxed);
+}
+
+void BandAnalyzer::GetBandRange(int band, float *low_hz,
+                                float *high_hz) const {
+  const float bin_hz = static_cast<float>(sample_rate_) / fft_.GetSize();
+  *low_hz = band_bins_[band] * bin_hz;
+  *high_hz = std::min(band_bins_[band + 1] * bin_hz, sample_rate_ / 2.0f);
+}
+
+void BandAnalyzer::Analyze() {
+  const int size = fft_.GetSize();
+  for (int n = 0; n < size; n++) {
+    input_[n] = history_[n] * window_[n];
+  }
+  fft_.PowerSpectrum(input_.data(), power_.data());
+  for (int b = 0; b < kBandCount; b++) {
+    band_levels_[b].store(GetLevel(band_bins_[b], band_bins_[b + 1]),
+                          std::memory_order_relaxed);
+  }
+  clap_level_ = GetLevel(clap_first_bin_, clap_end_bin_);
+}
+
+float BandAnalyzer::GetLevel(int first_bin, int end_bin) const {
+  // 单边谱：除了直流和奈奎斯特频点，每个频点都代表正负两个频率
+  const int m = fft_.GetSize() / 2;
+  float sum = 0.0f;
+  for (int k = first_bin; k < end_bin; k++) {
+    sum += k == 0 || k == m ? power_[k] : 2.0f * power_[k];
+  }
+  // Parseval：窗内的均方等于频谱能量除以N和窗函数的平方和
+  return std::sqrt(sum / (fft_.GetSize() * window_power_));
+}
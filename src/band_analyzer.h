@@ -0,0 +1,60 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+#include <vector>
+
+#include "real_fft.h"
+#include "simd.h"
+
+constexpr int kBandCount = 8;
+
+struct BandConfig {
+  // Power of two. A new spectrum is taken every fft_size / 2 samples of the
+  // analysis stream, 128 at 11025 Hz is one 256-frame callback.
+  int fft_size = 128;
+  // Loudness, and so calibration and GetRelativeAmplitude, follows the clap
+  // band instead of the whole spectrum. So do onsets and their strength.
+  bool clap_band_only = false;
+  float clap_low_hz = 2000.0f;
+  float clap_high_hz = 5000.0f;
+};
+
+// 音频回调里的滤波器组：加汉宁窗做实数FFT，按频带累加能量
+// Bands are octaves ending at the Nyquist frequency, the lowest one reaches
+// down to 0 Hz. Levels are the RMS amplitude within the band in [0, 1]
+// units, which is what a band-pass filtered signal would measure.
+class BandAnalyzer {
+ public:
+  void Init(int sample_rate, const BandConfig &config,
+            SimdLevel simd = GetSimdLevel());
+  // Audio thread only. Writes the clap band level for every input sample to
+  // clap_levels, held from the newest finished spectrum, so it can be fed to
+  // LoudnessMeter in place of the samples.
+  void Process(const float *samples, size_t sample_count, float *clap_levels);
+  // Newest spectrum, can be called from any thread
+  float GetBandLevel(int band) const;
+  void GetBandRange(int band, float *low_hz, float *high_hz) const;
+
+ private:
+  void Analyze();
+  float GetLevel(int first_bin, int end_bin) const;
+
+  int sample_rate_ = 44100;
+  int hop_ = 1;
+  RealFft fft_;
+  std::vector<float> window_;
+  // Sum of the squared window, for Parseval
+  float window_power_ = 1.0f;
+  // The last fft_size samples, oldest first
+  std::vector<float> history_;
+  int pending_ = 0;
+  std::vector<float> input_;
+  std::vector<float> power_;
+  // [first, end) bins of every band and of the clap band
+  int band_bins_[kBandCount + 1] = {};
+  int clap_first_bin_ = 0, clap_end_bin_ = 0;
+  float clap_level_ = 0.0f;
+  std::atomic<float> band_levels_[kBandCount];
+};
@@ -0,0 +1,105 @@
+#include "batch_runner.h"
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+void RandomClapPolicy::Reset(Uint64 seed) {
+  rng_.seed(static_cast<std::mt19937::result_type>(seed));
+  level_ = 0.0f;
+  steps_to_next_clap_ = 0;
+}
+
+float RandomClapPolicy::Next(GameSession &session) {
+  const float time_step = session.GetTimeStep();
+  if (steps_to_next_clap_-- <= 0) {
+    std::uniform_real_distribution<float> strength(0.4f, 1.0f);
+    std::uniform_int_distribution<int> interval(
+        static_cast<int>(0.3f / time_step), static_cast<int>(1.2f / time_step));
+    level_ = std::max(level_, strength(rng_));
+    steps_to_next_clap_ = interval(rng_);
+  }
+  const float amplitude = level_;
+  level_ *= std::pow(kDecayPerStep, time_step / kPhysicsTimeStep);
+  return amplitude;
+}
+
+int BatchResult::GetScorePercentile(float percentile) const {
+  const int count = static_cast<int>(episodes.size());
+  if (count == 0) {
+    return 0;
+  }
+  const int rank = std::clamp(
+      static_cast<int>(std::ceil(percentile * count)), 1, count);
+  int seen = 0;
+  for (size_t s = 0; s < score_histogram.size(); s++) {
+    seen += score_histogram[s];
+    if (seen >= rank) {
+      return static_cast<int>(s);
+    }
+  }
+  return max_score;
+}
+
+BatchRunner::BatchRunner(int threads) : pool_(threads) {
+  for (int i = 0; i < pool_.GetThreadCount(); i++) {
+    sessions_.push_back(std::make_unique<GameSession>());
+    // 工作线程本身已经占满所有核，关卡不再另开预取线程
+    sessions_.back()->SetLevelPrefetch(false);
+  }
+  policies_.resize(pool_.GetThreadCount());
+}
+
+int BatchRunner::GetThreadCount() const { return pool_.GetThreadCount(); }
+
+BatchResult BatchRunner::Run(const BatchConfig &config,
+                             const AmplitudePolicyFactory &policy_factory) {
+  using SteadyClock = std::chrono::steady_clock;
+  const SteadyClock::time_point begin = SteadyClock::now();
+
+  for (int i = 0; i < pool_.GetThreadCount(); i++) {
+    sessions_[i]->SetLookAhead(config.look_ahead);
+    sessions_[i]->SetParams(config.params);
+    policies_[i] = policy_factory();
+  }
+  const long long max_steps =
+      static_cast<long long>(config.max_episode_time / config.params.time_step);
+
+  BatchResult result;
+  result.episodes.resize(std::max(config.episodes, 0));
+  pool_.ParallelFor(result.episodes.size(), [&](size_t episode, int worker) {
+    GameSession &session = *sessions_[worker];
+    AmplitudePolicy &policy = *policies_[worker];
+    session.Seed(config.seed + episode);
+    session.Start(config.character_width, config.character_height);
+    policy.Reset(config.seed * 7919u + episode);
+    long long steps = 0;
+    while (steps < max_steps) {
+      steps++;
+      if (!session.Step(policy.Next(session))) {
+        break;
+      }
+    }
+    // 每局写自己的槽位，汇总放到最后按局的顺序做，结果与线程数无关
+    result.episodes[episode] = {session.GetScore(), steps};
+  });
+
+  result.min_score = result.episodes.empty() ? 0 : INT_MAX;
+  for (const EpisodeResult &episode : result.episodes) {
+    if (episode.score >= static_cast<int>(result.score_histogram.size())) {
+      result.score_histogram.resize(episode.score + 1, 0);
+    }
+    result.score_histogram[episode.score]++;
+    result.total_steps += episode.steps;
+    result.mean_score += episode.score;
+    result.min_score = std::min(result.min_score, episode.score);
+    result.max_score = std::max(result.max_score, episode.score);
+  }
+  if (!result.episodes.empty()) {
+    result.mean_score /= result.episodes.size();
+  }
+  result.wall_seconds =
+      std::chrono::duration<double>(SteadyClock::now() - begin).count();
+  return result;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <functional>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "config.h"
+#include "session.h"
+#include "work_stealing_pool.h"
+
+// 振幅策略：代替麦克风，每个物理步长给出一个相对振幅
+// Every worker thread owns its own instance, so implementations may keep
+// state without locking.
+class AmplitudePolicy {
+ public:
+  virtual ~AmplitudePolicy() = default;
+  // Called before the first step of every episode
+  virtual void Reset(Uint64 seed) = 0;
+  // Relative amplitude in [0, 1] for the next step, session may be inspected
+  // by closed-loop policies
+  virtual float Next(GameSession &session) = 0;
+};
+
+using AmplitudePolicyFactory =
+    std::function<std::unique_ptr<AmplitudePolicy>()>;
+
+// 随机间隔的一串"拍手"，每次拍手后指数衰减
+class RandomClapPolicy : public AmplitudePolicy {
+ public:
+  void Reset(Uint64 seed) override;
+  float Next(GameSession &session) override;
+
+ private:
+  // Per kPhysicsTimeStep, scaled for other step lengths
+  static constexpr float kDecayPerStep = 0.97f;
+
+  std::mt19937 rng_;
+  float level_ = 0.0f;
+  int steps_to_next_clap_ = 0;
+};
+
+struct BatchConfig {
+  int episodes = 1000;
+  // Episode i plays level seed + i
+  Uint64 seed = 1;
+  float max_episode_time = 120.0f;
+  int look_ahead = kLookAheadBlocks;
+  int character_width = 64;
+  int character_height = 110;
+  SessionParams params;
+};
+
+struct EpisodeResult {
+  int score = 0;
+  long long steps = 0;
+};
+
+struct BatchResult {
+  // In episode order, the same for any number of threads
+  std::vector<EpisodeResult> episodes;
+  // score_histogram[s] is the number of episodes that scored s
+  std::vector<int> score_histogram;
+  long long total_steps = 0;
+  double mean_score = 0.0;
+  int min_score = 0;
+  int max_score = 0;
+  double wall_seconds = 0.0;
+
+  // Nearest-rank percentile of the scores, percentile in [0, 1]
+  int GetScorePercentile(float percentile) const;
+};
+
+// 在所有核上并行跑大量互相独立的对局，用来评估振幅策略和调物理参数
+class BatchRunner {
+ public:
+  // 0 threads means one per hardware thread
+  explicit BatchRunner(int threads = 0);
+
+  int GetThreadCount() const;
+  BatchResult Run(const BatchConfig &config,
+                  const AmplitudePolicyFactory &policy_factory);
+
+ private:
+  WorkStealingPool pool_;
+  // One per worker, reused across episodes and batches
+  std::vector<std::unique_ptr<GameSession>> sessions_;
+  std::vector<std::unique_ptr<AmplitudePolicy>> policies_;
+};
@@ -0,0 +1,55 @@
+#include "block_ring.h"
+
+#include "game_error.h"
+
+void BlockRing::Init(size_t capacity) {
+  size_t n = 1;
+  while (n < capacity) {
+    n <<= 1;
+  }
+  x_.assign(n, 0);
+  y_.assign(n, 0);
+  w_.assign(n, 0);
+  h_.assign(n, 0);
+  mask_ = n - 1;
+  Clear();
+}
+
+void BlockRing::Clear() {
+  head_ = 0;
+  size_ = 0;
+  front_sequence_ = 0;
+}
+
+void BlockRing::PushBack(const SDL_Rect &block) {
+  if (size_ == mask_ + 1) {
+    throw GameError("Block ring is full");
+  }
+  const size_t j = Slot(size_);
+  x_[j] = block.x;
+  y_[j] = block.y;
+  w_[j] = block.w;
+  h_[j] = block.h;
+  size_++;
+}
+
+void BlockRing::PopFront() {
+  head_ = (head_ + 1) & mask_;
+  size_--;
+  front_sequence_++;
+}
+
+Uint64 BlockRing::GetFrontSequence() const { return front_sequence_; }
+
+size_t BlockRing::FindFirstRightOf(int x) const {
+  size_t low = 0, high = size_;
+  while (low < high) {
+    const size_t mid = (low + high) / 2;
+    if (GetRight(mid) <= x) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+  return low;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+// 定长的方块环形缓冲区，世界坐标，按结构数组存储
+// Blocks are pushed in increasing x and never overlap, so both left and right
+// edges are sorted, which the broadphase relies on.
+class BlockRing {
+ public:
+  // Capacity is rounded up to a power of two
+  void Init(size_t capacity);
+  void Clear();
+  void PushBack(const SDL_Rect &block);
+  void PopFront();
+  // Counts every block ever pushed, the front block has this sequence number
+  Uint64 GetFrontSequence() const;
+
+  // i is counted from the front
+  size_t GetSize() const { return size_; }
+  int GetLeft(size_t i) const { return x_[Slot(i)]; }
+  int GetRight(size_t i) const { return x_[Slot(i)] + w_[Slot(i)]; }
+  SDL_Rect Get(size_t i) const {
+    const size_t j = Slot(i);
+    return {x_[j], y_[j], w_[j], h_[j]};
+  }
+  // Index of the first block whose right edge is greater than x
+  size_t FindFirstRightOf(int x) const;
+
+ private:
+  size_t Slot(size_t i) const { return (head_ + i) & mask_; }
+
+  std::vector<int> x_, y_, w_, h_;
+  size_t mask_ = 0;
+  size_t head_ = 0;
+  size_t size_ = 0;
+  Uint64 front_sequence_ = 0;
+};
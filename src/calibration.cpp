@@ -0,0 +1,154 @@
+#include "calibration.h"
+
+#include <algorithm>
+#include <cmath>
+
+void P2Quantile::Init(float quantile) {
+  quantile_ = quantile;
+  count_ = 0;
+}
+
+void P2Quantile::Add(float x) {
+  if (count_ < 5) {
+    heights_[count_++] = x;
+    if (count_ == 5) {
+      std::sort(heights_, heights_ + 5);
+      const float p = quantile_;
+      const float desired[5] = {1.0f, 1.0f + 2.0f * p, 1.0f + 4.0f * p,
+                                3.0f + 2.0f * p, 5.0f};
+      const float increments[5] = {0.0f, p / 2.0f, p, (1.0f + p) / 2.0f,
+                                   1.0f};
+      for (int i = 0; i < 5; i++) {
+        positions_[i] = static_cast<float>(i + 1);
+        desired_[i] = desired[i];
+        increments_[i] = increments[i];
+      }
+    }
+    return;
+  }
+
+  int k;
+  if (x < heights_[0]) {
+    heights_[0] = x;
+    k = 0;
+  } else if (x >= heights_[4]) {
+    heights_[4] = x;
+    k = 3;
+  } else {
+    k = 0;
+    while (x >= heights_[k + 1]) {
+      k++;
+    }
+  }
+  for (int i = k + 1; i < 5; i++) {
+    positions_[i] += 1.0f;
+  }
+  for (int i = 0; i < 5; i++) {
+    desired_[i] += increments_[i];
+  }
+  count_++;
+
+  // 中间三个标记偏离理想位置超过1时移动一格
+  for (int i = 1; i <= 3; i++) {
+    const float d = desired_[i] - positions_[i];
+    if ((d >= 1.0f && positions_[i + 1] - positions_[i] > 1.0f) ||
+        (d <= -1.0f && positions_[i - 1] - positions_[i] < -1.0f)) {
+      const int sign = d > 0.0f ? 1 : -1;
+      const float h = Parabolic(i, static_cast<float>(sign));
+      if (heights_[i - 1] < h && h < heights_[i + 1]) {
+        heights_[i] = h;
+      } else {
+        heights_[i] = Linear(i, sign);
+      }
+      positions_[i] += static_cast<float>(sign);
+    }
+  }
+}
+
+float P2Quantile::GetQuantile() const {
+  if (count_ >= 5) {
+    return heights_[2];
+  }
+  if (count_ == 0) {
+    return 0.0f;
+  }
+  float sorted[5];
+  std::copy(heights_, heights_ + count_, sorted);
+  std::sort(sorted, sorted + count_);
+  const int i = static_cast<int>(std::lround(quantile_ * (count_ - 1)));
+  return sorted[i];
+}
+
+int P2Quantile::GetCount() const { return count_; }
+
+float P2Quantile::Parabolic(int i, float d) const {
+  const float *q = heights_;
+  const float *n = positions_;
+  return q[i] + d / (n[i + 1] - n[i - 1]) *
+                    ((n[i] - n[i - 1] + d) * (q[i + 1] - q[i]) /
+                         (n[i + 1] - n[i]) +
+                     (n[i + 1] - n[i] - d) * (q[i] - q[i - 1]) /
+                         (n[i] - n[i - 1]));
+}
+
+float P2Quantile::Linear(int i, int d) const {
+  return heights_[i] + d * (heights_[i + d] - heights_[i]) /
+                           (positions_[i + d] - positions_[i]);
+}
+
+void CalibrationEstimator::Init(float quantile, int min_samples,
+                                int max_samples, float tolerance) {
+  quantile_.Init(quantile);
+  min_samples_ = min_samples;
+  max_samples_ = max_samples;
+  tolerance_ = tolerance;
+  last_estimate_ = 0.0f;
+  stable_checks_ = 0;
+  converged_ = false;
+}
+
+void CalibrationEstimator::Add(float x) {
+  if (converged_) {
+    return;
+  }
+  quantile_.Add(x);
+  const int count = quantile_.GetCount();
+  if (count >= max_samples_) {
+    converged_ = true;
+    return;
+  }
+  if (count % kCheckInterval != 0) {
+    return;
+  }
+  const float estimate = quantile_.GetQuantile();
+  const float change = std::fabs(estimate - last_estimate_);
+  if (change <= tolerance_ * std::max(std::fabs(estimate), 1.0f)) {
+    stable_checks_++;
+  } else {
+    stable_checks_ = 0;
+  }
+  last_estimate_ = estimate;
+  converged_ = count >= min_samples_ && stable_checks_ >= kStableChecks;
+}
+
+bool CalibrationEstimator::HasConverged() const { return converged_; }
+
+float CalibrationEstimator::GetEstimate() const {
+  return quantile_.GetQuantile();
+}
+
+int CalibrationEstimator::GetCount() const { return quantile_.GetCount(); }
+
+void NoiseFloorTracker::Init(float initial, float quantile, float rate) {
+  floor_ = initial;
+  quantile_ = quantile;
+  rate_ = rate;
+}
+
+void NoiseFloorTracker::Add(float x) {
+  const float step = rate_ * std::max(floor_, 1.0f);
+  floor_ += x > floor_ ? step * quantile_ : -step * (1.0f - quantile_);
+  floor_ = std::max(floor_, 0.0f);
+}
+
+float NoiseFloorTracker::GetFloor() const { return floor_; }
@@ -0,0 +1,64 @@
+#pragma once
+
+// Jain和Chlamtac的P²算法，用五个标记在O(1)内存里在线估计分位数
+class P2Quantile {
+ public:
+  void Init(float quantile);
+  void Add(float x);
+  // Exact for fewer than five observations
+  float GetQuantile() const;
+  int GetCount() const;
+
+ private:
+  float Parabolic(int i, float d) const;
+  float Linear(int i, int d) const;
+
+  float quantile_ = 0.5f;
+  int count_ = 0;
+  float heights_[5];
+  float positions_[5];
+  float desired_[5];
+  float increments_[5];
+};
+
+// 校准用的分位数估计，估计值稳定下来就结束
+class CalibrationEstimator {
+ public:
+  // Converges once the estimate changes by less than tolerance (relative)
+  // over a few checks after at least min_samples, or after max_samples
+  void Init(float quantile, int min_samples, int max_samples,
+            float tolerance);
+  void Add(float x);
+  bool HasConverged() const;
+  float GetEstimate() const;
+  int GetCount() const;
+
+ private:
+  static constexpr int kCheckInterval = 8;
+  static constexpr int kStableChecks = 3;
+
+  P2Quantile quantile_;
+  int min_samples_ = 0;
+  int max_samples_ = 0;
+  float tolerance_ = 0.0f;
+  float last_estimate_ = 0.0f;
+  int stable_checks_ = 0;
+  bool converged_ = false;
+};
+
+// 游戏中持续跟踪噪声底，房间变吵时跟着上升
+// A stochastic-approximation quantile: every value nudges the estimate up by
+// rate * quantile or down by rate * (1 - quantile), relative to its size, so
+// it settles where that fraction of the values lies below it and follows
+// slow changes of the background while sparse claps barely move it.
+class NoiseFloorTracker {
+ public:
+  void Init(float initial, float quantile, float rate);
+  void Add(float x);
+  float GetFloor() const;
+
+ private:
+  float floor_ = 0.0f;
+  float quantile_ = 0.5f;
+  float rate_ = 0.0f;
+};
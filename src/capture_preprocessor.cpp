@@ -0,0 +1,252 @@
+#include "capture_preprocessor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "simd.h"
+
+constexpr int kFilterTapsPerDecimation = 8;
+// 截止频率留一点过渡带，低于新的奈奎斯特频率
+constexpr double kCutoffRatio = 0.9;
+constexpr float kDcTimeConstant = 0.1f;
+constexpr double kPi = 3.14159265358979323846;
+
+namespace {
+
+void DownmixScalar(const Sint16 *samples, size_t frames, int channels,
+                   float scale, float *mono) {
+  for (size_t f = 0; f < frames; f++) {
+    int sum = 0;
+    for (int c = 0; c < channels; c++) {
+      sum += samples[f * channels + c];
+    }
+    mono[f] = static_cast<float>(sum) * scale;
+  }
+}
+
+// 四路交错累加再按(0+2)+(1+3)合并，和SSE的水平求和顺序一致
+float SumScalar(const float *x, size_t n) {
+  float lanes[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  const size_t vector_count = n & ~static_cast<size_t>(3);
+  for (size_t i = 0; i < vector_count; i += 4) {
+    for (int j = 0; j < 4; j++) {
+      lanes[j] += x[i + j];
+    }
+  }
+  float sum = (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+  for (size_t i = vector_count; i < n; i++) {
+    sum += x[i];
+  }
+  return sum;
+}
+
+float DotScalar(const float *a, const float *b, size_t n) {
+  float lanes[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  for (size_t i = 0; i < n; i += 4) {
+    for (int j = 0; j < 4; j++) {
+      lanes[j] += a[i + j] * b[i + j];
+    }
+  }
+  return (lanes[0] + lanes[2]) + (lanes[1] + lanes[3]);
+}
+
+#ifdef HAKUSYU_X86
+
+float HorizontalSum(__m128 v) {
+  const __m128 pairs = _mm_add_ps(v, _mm_movehl_ps(v, v));
+  return _mm_cvtss_f32(
+      _mm_add_ss(pairs, _mm_shuffle_ps(pairs, pairs, _MM_SHUFFLE(1, 1, 1, 1))));
+}
+
+void DownmixSSE2(const Sint16 *samples, size_t frames, int channels,
+                 float scale, float *mono) {
+  const __m128 scale4 = _mm_set1_ps(scale);
+  size_t f = 0;
+  if (channels == 2) {
+    // madd把相邻的左右声道相加成32位整数
+    const __m128i ones = _mm_set1_epi16(1);
+    for (; f + 4 <= frames; f += 4) {
+      const __m128i x =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + f * 2));
+      const __m128 sum = _mm_cvtepi32_ps(_mm_madd_epi16(x, ones));
+      _mm_storeu_ps(mono + f, _mm_mul_ps(sum, scale4));
+    }
+  } else if (channels == 1) {
+    for (; f + 8 <= frames; f += 8) {
+      const __m128i x =
+          _mm_loadu_si128(reinterpret_cast<const __m128i *>(samples + f));
+      const __m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(x, x), 16);
+      const __m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(x, x), 16);
+      _mm_storeu_ps(mono + f, _mm_mul_ps(_mm_cvtepi32_ps(lo), scale4));
+      _mm_storeu_ps(mono + f + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), scale4));
+    }
+  }
+  DownmixScalar(samples + f * channels, frames - f, channels, scale, mono + f);
+}
+
+float SumSSE2(const float *x, size_t n) {
+  __m128 acc = _mm_setzero_ps();
+  const size_t vector_count = n & ~static_cast<size_t>(3);
+  for (size_t i = 0; i < vector_count; i += 4) {
+    acc = _mm_add_ps(acc, _mm_loadu_ps(x + i));
+  }
+  float sum = HorizontalSum(acc);
+  for (size_t i = vector_count; i < n; i++) {
+    sum += x[i];
+  }
+  return sum;
+}
+
+void SubtractSSE2(float *x, size_t n, float value) {
+  const __m128 v = _mm_set1_ps(value);
+  size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_ps(x + i, _mm_sub_ps(_mm_loadu_ps(x + i), v));
+  }
+  for (; i < n; i++) {
+    x[i] -= value;
+  }
+}
+
+float DotSSE2(const float *a, const float *b, size_t n) {
+  __m128 acc = _mm_setzero_ps();
+  for (size_t i = 0; i < n; i += 4) {
+    acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+  }
+  return HorizontalSum(acc);
+}
+
+#endif
+
+void Downmix(bool simd, const Sint16 *samples, size_t frames, int channels,
+             float scale, float *mono) {
+#ifdef HAKUSYU_X86
+  if (simd) {
+    DownmixSSE2(samples, frames, channels, scale, mono);
+    return;
+  }
+#endif
+  DownmixScalar(samples, frames, channels, scale, mono);
+}
+
+float Sum(bool simd, const float *x, size_t n) {
+#ifdef HAKUSYU_X86
+  if (simd) {
+    return SumSSE2(x, n);
+  }
+#endif
+  return SumScalar(x, n);
+}
+
+void Subtract(bool simd, float *x, size_t n, float value) {
+#ifdef HAKUSYU_X86
+  if (simd) {
+    SubtractSSE2(x, n, value);
+    return;
+  }
+#endif
+  for (size_t i = 0; i < n; i++) {
+    x[i] -= value;
+  }
+}
+
+float Dot(bool simd, const float *a, const float *b, size_t n) {
+#ifdef HAKUSYU_X86
+  if (simd) {
+    return DotSSE2(a, b, n);
+  }
+#endif
+  return DotScalar(a, b, n);
+}
+
+}  // namespace
+
+void CapturePreprocessor::Init(int channels, int sample_rate, int max_frames,
+                               const PreprocessConfig &config,
+                               SimdLevel simd) {
+  channels_ = std::max(channels, 1);
+  sample_rate_ = sample_rate;
+  max_frames_ = std::max(max_frames, 1);
+  decimation_ = std::clamp(config.decimation, 1, kMaxDecimation);
+  remove_dc_ = config.remove_dc;
+#ifdef HAKUSYU_X86
+  use_simd_ = simd != SimdLevel::kScalar;
+#else
+  use_simd_ = false;
+#endif
+
+  // 加Blackman窗的sinc低通
+  std::vector<double> h(1, 1.0);
+  if (decimation_ > 1) {
+    const int length = kFilterTapsPerDecimation * decimation_ + 1;
+    const double cutoff = kCutoffRatio * 0.5 / decimation_;
+    h.assign(length, 0.0);
+    double sum = 0.0;
+    for (int n = 0; n < length; n++) {
+      const double m = n - (length - 1) / 2.0;
+      const double sinc =
+          m == 0.0 ? 2.0 * cutoff
+                   : std::sin(2.0 * kPi * cutoff * m) / (kPi * m);
+      const double phase = 2.0 * kPi * n / (length - 1);
+      const double window =
+          0.42 - 0.5 * std::cos(phase) + 0.08 * std::cos(2.0 * phase);
+      h[n] = sinc * window;
+      sum += h[n];
+    }
+    for (double &tap : h) {
+      tap /= sum;
+    }
+  }
+  // 反转并在最旧的一端补零到4的倍数
+  const size_t length = (h.size() + 3) & ~static_cast<size_t>(3);
+  taps_.assign(length, 0.0f);
+  for (size_t j = 0; j < h.size(); j++) {
+    taps_[length - 1 - j] = static_cast<float>(h[j]);
+  }
+
+  work_.assign(taps_.size() - 1 + max_frames_, 0.0f);
+  next_output_ = taps_.size() - 1;
+  dc_ = 0.0f;
+  dc_time_constant_frames_ = kDcTimeConstant * sample_rate_;
+}
+
+int CapturePreprocessor::GetOutputRate() const {
+  return sample_rate_ / decimation_;
+}
+
+size_t CapturePreprocessor::GetMaxOutput() const {
+  return static_cast<size_t>(max_frames_ / decimation_ + 1);
+}
+
+size_t CapturePreprocessor::Process(const Sint16 *samples, size_t frames,
+                                    float *output) {
+  // work_和output都只按max_frames分配
+  SDL_assert(frames <= static_cast<size_t>(max_frames_));
+  if (frames == 0) {
+    return 0;
+  }
+  const size_t history = taps_.size() - 1;
+  float *mono = work_.data() + history;
+  const float scale = 1.0f / (32768.0f * channels_);
+  Downmix(use_simd_, samples, frames, channels_, scale, mono);
+
+  if (remove_dc_) {
+    // 直流分量按块的均值一阶低通跟踪，整块减去同一个值
+    const float alpha = 1.0f - std::exp(-static_cast<float>(frames) /
+                                        dc_time_constant_frames_);
+    dc_ += (Sum(use_simd_, mono, frames) / frames - dc_) * alpha;
+    Subtract(use_simd_, mono, frames, dc_);
+  }
+
+  size_t count = 0;
+  const size_t end = history + frames;
+  size_t p = next_output_;
+  for (; p < end; p += decimation_) {
+    const float *window = work_.data() + p - history;
+    output[count++] = Dot(use_simd_, taps_.data(), window, taps_.size());
+  }
+  next_output_ = p - frames;
+  std::memmove(work_.data(), work_.data() + frames, history * sizeof(float));
+  return count;
+}
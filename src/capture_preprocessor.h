@@ -0,0 +1,52 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+#include "simd.h"
+
+constexpr int kMaxDecimation = 8;
+
+struct PreprocessConfig {
+  // The analysis rate is the capture rate divided by this, 1 to kMaxDecimation
+  int decimation = 4;
+  bool remove_dc = true;
+};
+
+// 音频回调里的预处理：混成单声道、去直流、抗混叠降采样、转成[-1, 1]的浮点
+// Everything downstream (loudness, onsets) then touches decimation times
+// fewer samples per channel, so 8x fewer samples than stereo at the default
+// decimation of 4. Floats are twice the size of S16, so that is 4x fewer
+// bytes. The SIMD and scalar paths sum in the same lane order, so their
+// output is bit-identical.
+class CapturePreprocessor {
+ public:
+  // max_frames is the largest callback, Process takes at most that many frames
+  void Init(int channels, int sample_rate, int max_frames,
+            const PreprocessConfig &config,
+            SimdLevel simd = GetSimdLevel());
+  int GetOutputRate() const;
+  // Upper bound of the output of one Process call
+  size_t GetMaxOutput() const;
+  // Audio thread only, frames must not exceed max_frames. Returns the number
+  // of samples written to output.
+  size_t Process(const Sint16 *samples, size_t frames, float *output);
+
+ private:
+  int channels_ = 1;
+  int sample_rate_ = 44100;
+  int max_frames_ = 0;
+  int decimation_ = 1;
+  bool remove_dc_ = true;
+  bool use_simd_ = false;
+  // Reversed, so every output is a contiguous dot product. The length is a
+  // multiple of four.
+  std::vector<float> taps_;
+  // The last taps_.size() - 1 mono samples followed by the current chunk
+  std::vector<float> work_;
+  // Offset of the next output sample past the end of the current chunk
+  size_t next_output_ = 0;
+  float dc_ = 0.0f;
+  float dc_time_constant_frames_ = 0.0f;
+};
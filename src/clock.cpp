@@ -0,0 +1,53 @@
+#include "clock.h"
+
+PerformanceClock::PerformanceClock()
+    : start_(SDL_GetPerformanceCounter()),
+      seconds_per_tick_(1.0 / SDL_GetPerformanceFrequency()) {}
+
+double PerformanceClock::GetSeconds() {
+  return (SDL_GetPerformanceCounter() - start_) * seconds_per_tick_;
+}
+
+double ManualClock::GetSeconds() { return seconds_; }
+
+void ManualClock::Advance(double seconds) { seconds_ += seconds; }
+
+void StreamClock::Reset(int sample_rate) {
+  sample_rate_ = sample_rate;
+  frames_.store(0, std::memory_order_relaxed);
+}
+
+void StreamClock::AddFrames(Uint64 frames) {
+  frames_.fetch_add(frames, std::memory_order_relaxed);
+}
+
+double StreamClock::GetSeconds() {
+  return static_cast<double>(frames_.load(std::memory_order_relaxed)) /
+         sample_rate_;
+}
+
+FixedTimestep::FixedTimestep(double step, int max_steps)
+    : step_(step), max_steps_(max_steps) {}
+
+void FixedTimestep::Reset(double now) {
+  last_time_ = now;
+  accumulator_ = 0.0;
+}
+
+int FixedTimestep::Advance(double now) {
+  accumulator_ += now - last_time_;
+  last_time_ = now;
+  int steps = static_cast<int>(accumulator_ / step_);
+  if (steps > max_steps_) {
+    steps = max_steps_;
+    accumulator_ = step_ * steps;
+  }
+  accumulator_ -= step_ * steps;
+  return steps;
+}
+
+float FixedTimestep::GetAlpha() const {
+  return static_cast<float>(accumulator_ / step_);
+}
+
+double FixedTimestep::GetStep() const { return step_; }
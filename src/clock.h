@@ -0,0 +1,63 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+
+// 可注入的高精度时钟，换成ManualClock就可以比实时更快地推进模拟
+class Clock {
+ public:
+  virtual ~Clock() = default;
+  virtual double GetSeconds() = 0;
+};
+
+class PerformanceClock : public Clock {
+ public:
+  PerformanceClock();
+  double GetSeconds() override;
+
+ private:
+  Uint64 start_;
+  double seconds_per_tick_;
+};
+
+class ManualClock : public Clock {
+ public:
+  double GetSeconds() override;
+  void Advance(double seconds);
+
+ private:
+  double seconds_ = 0.0;
+};
+
+// 按送出的音频帧数计时，倍速播放时游戏跟着音频走
+// Written by the thread that delivers the audio, read from any thread.
+class StreamClock : public Clock {
+ public:
+  void Reset(int sample_rate);
+  void AddFrames(Uint64 frames);
+  double GetSeconds() override;
+
+ private:
+  int sample_rate_ = 1;
+  std::atomic<Uint64> frames_{0};
+};
+
+// 固定步长的时间累加器
+class FixedTimestep {
+ public:
+  FixedTimestep(double step, int max_steps);
+  void Reset(double now);
+  // Returns how many fixed steps to run to catch up with now. Time beyond
+  // max_steps is dropped so a long stall cannot snowball.
+  int Advance(double now);
+  // How far the leftover time is into the next step, for render interpolation
+  float GetAlpha() const;
+  double GetStep() const;
+
+ private:
+  double step_;
+  int max_steps_;
+  double last_time_ = 0.0;
+  double accumulator_ = 0.0;
+};
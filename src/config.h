@@ -0,0 +1,20 @@
+#pragma once
+
+// 游戏逻辑用到的常量，窗口版和无头版共用
+
+constexpr int division = 6;
+// 同时存在的方块数，压力测试时可以远大于一屏
+constexpr int kLookAheadBlocks = division * 2;
+constexpr int kWindowWidth = 800;
+constexpr int kWindowHeight = 680;
+constexpr int kCharacterPosition = kWindowWidth / 10;
+
+constexpr float kRelativeAmplitudeToVerticalSpeed = 50.0f;
+constexpr float kRelativeAmplitudeToHorizontalSpeed = 30.0f;
+constexpr float kRelativeAmplitudeToClapSpeed = 150.0f;
+constexpr float kFrictionHorizontal = 0.05f;
+constexpr float kFrictionVertical = 0.001f;
+constexpr float kGravity = 500.0f;
+constexpr float kPhysicsTimeStep = 1.0f / 240;
+// 振幅参数是按每帧施加一次（60Hz）调出来的
+constexpr float kAmplitudeImpulseRate = 60.0f;
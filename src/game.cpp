@@ -2,45 +2,65 @@
 
 #include <SDL2/SDL_image.h>
 
-#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <random>
-#include <sstream>
+
+#include "allocation_counter.h"
+#include "assets.h"
+#include "config.h"
+#include "latency_tracer.h"
+#include "profiler.h"
 
 #define _DEBUG_GAME
 
 static std::random_device rd;
-static std::mt19937 rng;
-static Uint8 *gCurrentRecordingBuffer = nullptr;
-static size_t gCurrentRecordingBufferPosition = 0;
-
-constexpr int division = 6;
-constexpr int kWindowWidth = 800;
-constexpr int kWindowHeight = 680;
-constexpr int kCharacterPosition = kWindowWidth / 10;
+// SetupEnvironment开始的时刻，启动耗时都从这里算起
+static Uint64 startup_counter = 0;
+
 constexpr int kDefaultLineMargin = 20;
 constexpr int kDefaultPointSize = 28;
-constexpr int kMaxRecordTime = 1;
-constexpr int kBufferRecordTime = 2;
-constexpr int kSuggestClipTime = 10;
-
-constexpr float kRelativeAmplitudeToVerticalSpeed = 50.0f;
-constexpr float kRelativeAmplitudeToHorizontalSpeed = 30.0f;
-constexpr float kFrictionHorizontal = 0.05f;
-constexpr float kFrictionVertical = 0.001f;
-constexpr float kGravity = 500.0f;
+constexpr size_t kTextCacheCapacity = 32;
+constexpr int kLoudnessHistoryTime = 2000;
+constexpr int kLoudnessWindowTime = 10;
+
+constexpr int kIdleWaitTimeout = 250;
+constexpr const char *kProfileCsvPath = "profile.csv";
+constexpr const char *kLatencyCsvPath = "latency.csv";
+constexpr const char *kLatencyTracePath = "latency_trace.json";
+constexpr int kCalibrationPollInterval = 20;
+constexpr int kCalibrationMinWindows = 30;
+constexpr int kCalibrationMaxWindows = 300;
+// 拍手的窗口彼此相关，估计值收敛得慢，最多只取0.6秒有声音的窗口
+constexpr int kPeakMaxWindows = 60;
+constexpr float kCalibrationTolerance = 0.02f;
+// 噪声底取安静时响度的低分位数，最大音量取拍手时的高分位数
+constexpr float kNoiseFloorQuantile = 0.2f;
+constexpr float kPeakQuantile = 0.75f;
+// Only windows this many times above the noise floor count as applause
+constexpr float kPeakGateRatio = 3.0f;
+constexpr float kNoiseFloorTrackingRate = 0.02f;
+// 跟踪到的噪声底最多偏离校准值这么多倍，校准得到的范围不会越漂越远
+constexpr float kNoiseFloorMaxRatio = 2.0f;
+constexpr int kMaxLoudnessWindowsPerUpdate = 64;
 constexpr float kSimulateRelativeAmplitude = 1.0f;
+constexpr int kMaxPhysicsStepsPerFrame = 24;
+// 前几帧里各个缓冲区还在增长到稳定的大小
+constexpr int kAllocationCheckWarmupFrames = 60;
+// 分数和性能叠加层加起来的字形数上限
+constexpr int kMaxFrameGlyphs = 512;
 
 constexpr SDL_Color kDefaultTextColor = {0, 0, 0, 0xFF};
 constexpr SDL_Color kNotHitBlockColor = {0, 0, 0, 0xFF};
 constexpr SDL_Color kHitBlockColor = {65, 105, 225, 0xFF};
 
-constexpr int kCollisionX = 1;
-constexpr int kCollisionY = 2;
-constexpr int kCollisionBoth = kCollisionX | kCollisionY;
+constexpr const char *kCharacterImagePath = "images/foo.png";
+constexpr const char *kFontPath = "fonts/lazy.ttf";
 
 constexpr const char *kWindowTitle = "Hakusyu - Developed by Shinonome Yuugata";
 
-const std::vector<std::vector<std::string>> kHelpTexts{
+const TextLines kHelpTexts[] = {
     {"Hello, welcome to Hakusyu!",
      "Hakusyu is a platform game using sound control",
      "That means, by the volume of applaud",
@@ -50,55 +70,35 @@ const std::vector<std::vector<std::string>> kHelpTexts{
     {"Now please select your microphone by entering number",
      "If you see garbled characters, don't worry", "Just select a random one",
      "<Press Enter to Continue>"}};
+constexpr int kHelpPageCount = sizeof(kHelpTexts) / sizeof(kHelpTexts[0]);
 
-const std::vector<std::string> kPromptNoRecorderDevice{
+const TextLines kPromptNoRecorderDevice{
     "Bro you need a microphone to play this game", "<Press Any Key To Exit>"};
 
-const std::vector<std::string> kPromptSelectRecorderDevice{
+const TextLines kPromptSelectRecorderDevice{
     "Enter a Number Key to Select Recorder Device",
     "You can use either num key rows or num pad",
 };
 
-const std::vector<std::string> kPromptRecordingMinimumVolume{
+const TextLines kPromptRecordingMinimumVolume{
     "Please keep quiet.", "We will now record your minimum volume",
     "<Press Enter To Start>"};
 
-const std::vector<std::string> kPromptRecordingMaximumVolume{
+const TextLines kPromptRecordingMaximumVolume{
     "Please applaud as loudly as you can.",
-    "We will record your maximum volume", "<Press Enter To Start>"};
+    "We will record your maximum volume", "<Press Enter To Start>",
+    "Recording starts with your first clap"};
 
-const std::vector<std::string> kPromptReadyForGame{
+const TextLines kPromptReadyForGame{
     "You are all set!", "<Please Enter to Start Game>",
     "For your interest, this is your game arguments: "};
 
-const std::vector<std::string> kPromptGameEnd{
+const TextLines kPromptGameEnd{
     "Game End!",
     "Now you can press <Enter> to start a new game.",
     "Your score is, very surprisingly: ",
 };
 
-inline int CheckBoxCollision(const SDL_Rect &a, const SDL_Rect &b) {
-  // 分离轴算法
-  const int left_a = a.x;
-  const int right_a = a.x + a.w;
-  const int top_a = a.y;
-  const int bottom_a = a.y + a.h;
-  const int left_b = b.x;
-  const int right_b = b.x + b.w;
-  const int top_b = b.y;
-  const int bottom_b = b.y + b.h;
-
-  int result = kCollisionBoth;
-  if (right_a <= left_b || right_b <= left_a) {
-    result &= ~kCollisionX;
-  }
-  if (bottom_a <= top_b || bottom_b <= top_a) {
-    result &= ~kCollisionY;
-  }
-
-  return result;
-}
-
 template <typename T>
 T clap(T &val, const T &min, const T &max) {
   if (val < min) {
@@ -109,9 +109,6 @@ T clap(T &val, const T &min, const T &max) {
   return val;
 }
 
-// 符号函数
-inline float Sign(float f) { return f < 0.0f ? -1.0f : 1.0f; }
-
 // The only proper way to do this
 inline int GetNumberOfKey(SDL_Keycode key) {
   switch (key) {
@@ -160,7 +157,31 @@ inline int GetNumberOfKey(SDL_Keycode key) {
   }
 }
 
+namespace {
+
+TTF_Font *OpenFont() {
+  SDL_RWops *file = OpenAsset(kFontPath);
+  if (file == nullptr) {
+    throw GameError(SDL_GetError());
+  }
+  TTF_Font *font = TTF_OpenFontRW(file, SDL_TRUE, kDefaultPointSize);
+  if (font == nullptr) {
+    throw GameError(TTF_GetError());
+  }
+  return font;
+}
+
+void ReportStartupTime(const char *milestone) {
+  const double milliseconds =
+      static_cast<double>(SDL_GetPerformanceCounter() - startup_counter) *
+      1000.0 / SDL_GetPerformanceFrequency();
+  SDL_Log("%s %.1f ms after startup", milestone, milliseconds);
+}
+
+}  // namespace
+
 void Game::SetupEnvironment() {
+  startup_counter = SDL_GetPerformanceCounter();
   int result = SDL_Init(SDL_INIT_VIDEO | SDL_INIT_AUDIO);
   if (result < 0) {
     throw GameError(SDL_GetError());
@@ -177,8 +198,42 @@ void Game::SetupEnvironment() {
   if (result != 0) {
     throw GameError(TTF_GetError());
   }
+}
+
+Game::Game()
+    : clock_(&performance_clock_),
+      physics_timestep_(kPhysicsTimeStep, kMaxPhysicsStepsPerFrame) {}
+
+Game::~Game() {
+  StopSimulation();
+  if (asset_thread_.joinable()) {
+    asset_thread_.join();
+  }
+}
+
+void Game::SetClock(Clock *clock) { clock_ = clock; }
+
+void Game::SetLevelSeed(Uint64 seed) {
+  level_seed_ = seed;
+  has_fixed_level_seed_ = true;
+}
+
+void Game::SetAudioSource(std::unique_ptr<AudioSource> source) {
+  // 倍速播放时物理按音频的时间推进，游戏和实时播放时完全一样
+  if (source != nullptr && source->GetStreamClock() != nullptr) {
+    clock_ = source->GetStreamClock();
+  }
+  audio_source_ = std::move(source);
+}
+
+void Game::SetReplayLog(const char *path) { replay_writer_.Open(path); }
 
-  rng.seed(rd());
+void Game::SetClapBand(float low_hz, float high_hz) {
+  BandConfig config;
+  config.clap_band_only = true;
+  config.clap_low_hz = low_hz;
+  config.clap_high_hz = high_hz;
+  recorder_.SetBandAnalysis(config);
 }
 
 void Game::Init() {
@@ -196,86 +251,313 @@ void Game::Init() {
   if (renderer_ == nullptr) {
     throw GameError(SDL_GetError());
   }
+  SDL_RendererInfo renderer_info;
+  if (SDL_GetRendererInfo(renderer_, &renderer_info) == 0) {
+    has_vsync_ = (renderer_info.flags & SDL_RENDERER_PRESENTVSYNC) != 0;
+  }
 
-  SDL_Surface *character_sprite = IMG_Load("images/foo.png");
-  if (character_sprite == nullptr) {
-    throw GameError(IMG_GetError());
+  // 帮助页面只需要font_，其余资源在第一帧显示之后才用到
+  font_ = OpenFont();
+  atlas_font_ = OpenFont();
+  wake_event_type_ = SDL_RegisterEvents(1);
+  text_cache_.Init(renderer_, font_, kDefaultTextColor, kTextCacheCapacity);
+  asset_thread_ = std::thread(&Game::LoadAssets, this);
+}
+
+void Game::LoadAssets() {
+  try {
+    SDL_RWops *file = OpenAsset(kCharacterImagePath);
+    if (file == nullptr) {
+      throw GameError(SDL_GetError());
+    }
+    SDL_Surface *character_sprite = IMG_Load_RW(file, SDL_TRUE);
+    if (character_sprite == nullptr) {
+      throw GameError(IMG_GetError());
+    }
+    SDL_SetColorKey(character_sprite, SDL_TRUE,
+                    SDL_MapRGB(character_sprite->format, 0, 0xFF, 0xFF));
+    character_surface_ = character_sprite;
+    glyph_atlas_.Rasterize(atlas_font_, kDefaultTextColor);
+  } catch (...) {
+    asset_error_ = std::current_exception();
+  }
+  assets_decoded_.store(true, std::memory_order_release);
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = wake_event_type_;
+  SDL_PushEvent(&event);
+}
+
+bool Game::FinishAssetLoading(bool wait) {
+  if (assets_ready_) {
+    return true;
+  }
+  if (!wait && !assets_decoded_.load(std::memory_order_acquire)) {
+    return false;
   }
-  SDL_SetColorKey(character_sprite, SDL_TRUE,
-                  SDL_MapRGB(character_sprite->format, 0, 0xFF, 0xFF));
+  asset_thread_.join();
+  TTF_CloseFont(atlas_font_);
+  atlas_font_ = nullptr;
+  if (asset_error_ != nullptr) {
+    std::rethrow_exception(asset_error_);
+  }
+
+  // 纹理只能在渲染线程创建
   character_texture_ =
-      SDL_CreateTextureFromSurface(renderer_, character_sprite);
+      SDL_CreateTextureFromSurface(renderer_, character_surface_);
   if (character_texture_ == nullptr) {
     throw GameError(SDL_GetError());
   }
-  character_texture_wh_.w = character_sprite->w;
-  character_texture_wh_.h = character_sprite->h;
-  SDL_FreeSurface(character_sprite);
+  character_texture_wh_.w = character_surface_->w;
+  character_texture_wh_.h = character_surface_->h;
+  SDL_FreeSurface(character_surface_);
+  character_surface_ = nullptr;
   SDL_SetTextureBlendMode(character_texture_, SDL_BLENDMODE_BLEND);
-
-  font_ = TTF_OpenFont("fonts/lazy.ttf", kDefaultPointSize);
-  if (font_ == nullptr) {
-    throw GameError(TTF_GetError());
-  }
+  glyph_atlas_.Upload(renderer_);
+  // 游戏画面的分组提前建好并留足容量，稳态的帧不再分配
+  render_batch_.ReserveRects(kNotHitBlockColor, kLookAheadBlocks + 1);
+  render_batch_.ReserveRects(kHitBlockColor, kLookAheadBlocks + 1);
+  render_batch_.ReserveQuads(character_texture_, 1);
+  render_batch_.ReserveQuads(glyph_atlas_.GetTexture(), kMaxFrameGlyphs);
+  assets_ready_ = true;
+  ReportStartupTime("Assets ready");
+  return true;
 }
 
 void Game::StartNewGame() {
-  blocks_.clear();
-  blocks_hit_state_.clear();
-  GenNewBlock();
-  blocks_hit_state_.front() = true;
-  blocks_.front().x = kCharacterPosition;
-  for (int i = 1; i < division * 2; i++) {
-    GenNewBlock();
-  }
-
-  SDL_Rect character_box;
-  character_box.w = character_texture_wh_.w;
-  character_box.h = character_texture_wh_.h;
-  character_box.x = kCharacterPosition;
-  character_box.y = blocks_.front().y - character_box.h;
-  physics_object_.Init(character_box);
-  physics_object_.ApplyForce(0, kGravity);
-  physics_object_.SetFriction(kFrictionHorizontal, kFrictionVertical);
-  score_ = 0;
+  StopSimulation();
+  FinishAssetLoading(true);
+  if (!has_fixed_level_seed_) {
+    level_seed_ = (static_cast<Uint64>(rd()) << 32) | rd();
+  }
+  session_.Seed(level_seed_);
+  session_.Start(character_texture_wh_.w, character_texture_wh_.h);
+  if (replay_writer_.IsOpen()) {
+    replay_writer_.BeginGame(level_seed_, character_texture_wh_.w,
+                             character_texture_wh_.h, session_.GetParams());
+  }
+  // 每局都从校准的噪声底重新开始跟踪
+  noise_floor_.Init(minimum_amplitude_, kNoiseFloorQuantile,
+                    kNoiseFloorTrackingRate);
+  noise_floor_offset_ = 0.0f;
+  physics_timestep_.Reset(clock_->GetSeconds());
+  // 先发布初始状态，渲染线程第一帧就有快照可画
+  WorldSnapshot &snapshot = snapshots_.GetBackBuffer();
+  session_.FillSnapshot(&snapshot);
+  snapshot.time = clock_->GetSeconds();
+  snapshot.relative_amplitude = 0.0f;
+  snapshots_.Publish();
+  snapshots_.Update();
+  SDL_Keycode key;
+  while (debug_keys_.Pop(&key)) {
+  }
+  loudness_cursor_ = recorder_.GetLoudnessCursor();
+  gaming_frames_ = 0;
   state_ = GameState::kGaming;
+  simulation_running_.store(true, std::memory_order_relaxed);
+  simulation_thread_ = std::thread(&Game::SimulationMain, this);
+}
+
+void Game::SimulationMain() {
+  while (simulation_running_.load(std::memory_order_relaxed)) {
+    float relative_amplitude;
+    Uint64 capture_timestamp, amplitude_timestamp;
+    {
+      HAKUSYU_PROFILE_SCOPE(ProfileStage::kAmplitude);
+      // 先取时间戳再读响度，记下的音频块不会比实际用到的新
+      capture_timestamp = recorder_.GetCaptureTimestamp();
+      UpdateNoiseFloor();
+      const float sys_amplitude = recorder_.GetLoudness();
+      relative_amplitude = GetRelativeAmplitude(sys_amplitude);
+      // relative_amplitude = kSimulateRelativeAmplitude;
+      OnsetEvent onset;
+      while (recorder_.PollOnset(&onset)) {
+        // 拍手立即给一个向上的冲量，不用等响度窗口填满
+        const float strength = GetRelativeAmplitude(onset.strength);
+        session_.ApplyClap(strength);
+        if (replay_writer_.IsOpen()) {
+          replay_writer_.AddClap(strength);
+        }
+      }
+      amplitude_timestamp = SDL_GetPerformanceCounter();
+    }
+#ifdef _DEBUG_GAME
+    // 调试按键也是这一局的输入，同样写进回放日志
+    SDL_Keycode key;
+    while (debug_keys_.Pop(&key)) {
+      switch (key) {
+        case SDLK_KP_0:
+          ApplyDebugShift(3);
+          break;
+        case SDLK_KP_1:
+          ApplyDebugVelocity(0.0f, -1000.0f);
+          break;
+        case SDLK_KP_2:
+          ApplyDebugVelocity(-500.0f, 0.0f);
+          break;
+      }
+    }
+#endif
+
+    const double now = clock_->GetSeconds();
+    const int steps = physics_timestep_.Advance(now);
+    bool running = true;
+    int executed = 0;
+    for (; executed < steps && running; executed++) {
+      running = session_.Step(relative_amplitude);
+    }
+    if (replay_writer_.IsOpen()) {
+      replay_writer_.AddSteps(relative_amplitude, executed);
+      if (!running) {
+        replay_writer_.EndGame(session_.GetScore(), session_.GetCameraX(),
+                               session_.GetPhysicsObject().GetBox());
+      }
+    }
+    if (steps > 0 || !running) {
+      WorldSnapshot &snapshot = snapshots_.GetBackBuffer();
+      session_.FillSnapshot(&snapshot);
+      snapshot.time = now - physics_timestep_.GetAlpha() * kPhysicsTimeStep;
+      snapshot.relative_amplitude = relative_amplitude;
+      snapshot.capture_timestamp = capture_timestamp;
+      snapshot.amplitude_timestamp = amplitude_timestamp;
+      snapshot.physics_timestamp = SDL_GetPerformanceCounter();
+      snapshots_.Publish();
+    }
+    if (!running) {
+      // 唤醒可能在等待事件的主线程
+      SDL_Event event;
+      SDL_zero(event);
+      event.type = wake_event_type_;
+      SDL_PushEvent(&event);
+      return;
+    }
+    // 睡到下一个物理步长，和显示器的刷新无关
+    const double wait = (1.0 - physics_timestep_.GetAlpha()) * kPhysicsTimeStep;
+    std::this_thread::sleep_for(std::chrono::duration<double>(wait));
+  }
+}
+
+void Game::ApplyDebugShift(int pixels) {
+  session_.ShiftBlocks(pixels);
+  if (replay_writer_.IsOpen()) {
+    replay_writer_.AddShift(pixels);
+  }
+}
+
+void Game::ApplyDebugVelocity(float v_x, float v_y) {
+  session_.GetPhysicsObject().ApplyVelocity(v_x, v_y);
+  if (replay_writer_.IsOpen()) {
+    replay_writer_.AddVelocity(v_x, v_y);
+  }
+}
+
+void Game::StopSimulation() {
+  simulation_running_.store(false, std::memory_order_relaxed);
+  if (simulation_thread_.joinable()) {
+    simulation_thread_.join();
+  }
 }
 
 bool Game::RenderPromptToSelectRecorderDevices() {
   auto devices = Recorder::GetRecorderDevices();
   // auto devices = std::vector<std::string>{};
 
-  std::vector<std::string> audio_device_prompts;
+  TextLines audio_device_prompts;
   if (devices.size() > 0) {
-    audio_device_prompts.insert(audio_device_prompts.end(),
-                                kPromptSelectRecorderDevice.begin(),
-                                kPromptSelectRecorderDevice.end());
+    audio_device_prompts.Add(kPromptSelectRecorderDevice);
   } else {
-    audio_device_prompts.insert(audio_device_prompts.end(),
-                                kPromptNoRecorderDevice.begin(),
-                                kPromptNoRecorderDevice.end());
+    audio_device_prompts.Add(kPromptNoRecorderDevice);
   }
   for (int i = 0; i < devices.size(); i++) {
-    audio_device_prompts.push_back(std::to_string(i) + ": " + devices[i]);
+    audio_device_prompts.Format("%d: %s", i, devices[i].c_str());
   }
   RenderTexts(audio_device_prompts, true, kDefaultLineMargin);
   return devices.size() > 0;
 }
 
+void Game::StartCalibration(float quantile, int max_windows) {
+  calibration_.Init(quantile, kCalibrationMinWindows, max_windows,
+                    kCalibrationTolerance);
+  loudness_cursor_ = recorder_.GetLoudnessCursor();
+  calibrating_ = true;
+}
+
+bool Game::UpdateCalibration() {
+  float windows[kMaxLoudnessWindowsPerUpdate];
+  int n;
+  while ((n = recorder_.ReadLoudnessWindows(
+              &loudness_cursor_, windows, kMaxLoudnessWindowsPerUpdate)) > 0) {
+    for (int i = 0; i < n; i++) {
+      // 测最大音量时从第一下拍手开始算，不用固定的等待时间
+      if (state_ == GameState::kRecordingMaximumVolume &&
+          windows[i] <= minimum_amplitude_ * kPeakGateRatio) {
+        continue;
+      }
+      calibration_.Add(windows[i]);
+    }
+  }
+  if (calibration_.HasConverged()) {
+    calibrating_ = false;
+    return true;
+  }
+  return false;
+}
+
+void Game::UpdateNoiseFloor() {
+  float windows[kMaxLoudnessWindowsPerUpdate];
+  int n;
+  while ((n = recorder_.ReadLoudnessWindows(
+              &loudness_cursor_, windows, kMaxLoudnessWindowsPerUpdate)) > 0) {
+    for (int i = 0; i < n; i++) {
+      // 和校准一样，拍手和唱歌的窗口不算背景
+      if (windows[i] <= minimum_amplitude_ * kPeakGateRatio) {
+        noise_floor_.Add(windows[i]);
+      }
+    }
+  }
+  // 校准值不变，整个范围按跟踪到的噪声底平移
+  const float floor =
+      std::clamp(noise_floor_.GetFloor(),
+                 minimum_amplitude_ / kNoiseFloorMaxRatio,
+                 minimum_amplitude_ * kNoiseFloorMaxRatio);
+  noise_floor_offset_ = floor - minimum_amplitude_;
+}
+
 float Game::GetRelativeAmplitude(float real_amplitude) {
-  float r = (real_amplitude - minimum_amplitude_) /
+  float r = (real_amplitude - minimum_amplitude_ - noise_floor_offset_) /
             (maximum_amplitude_ - minimum_amplitude_);
   return clap(r, 0.0f, 1.0f);
 }
 
+int Game::GetEventWaitTimeout() {
+  if (need_rerender) {
+    return 0;
+  }
+  switch (state_) {
+    case GameState::kGaming:
+      // 有垂直同步时由SDL_RenderPresent控制节奏，否则每个物理步长画一帧，
+      // 游戏结束时模拟线程会提前唤醒
+      return has_vsync_ ? 0
+                        : std::max(1, static_cast<int>(kPhysicsTimeStep * 1000));
+    case GameState::kRecordingMinimumVolume:
+    case GameState::kRecordingMaximumVolume:
+      return calibrating_ ? kCalibrationPollInterval : kIdleWaitTimeout;
+    default:
+      return kIdleWaitTimeout;
+  }
+}
+
 void Game::Main() {
   bool exit = false;
   SDL_Event e;
 
   // StartNewGame();
   while (!exit) {
-  main_loop_begin:
-    while (SDL_PollEvent(&e)) {
+    // 空闲时阻塞等待输入或音频线程的唤醒，而不是空转
+    const int timeout = GetEventWaitTimeout();
+    bool has_event = timeout > 0 ? SDL_WaitEventTimeout(&e, timeout) != 0
+                                 : SDL_PollEvent(&e) != 0;
+    for (; has_event; has_event = SDL_PollEvent(&e) != 0) {
       if (e.type == SDL_QUIT) {
         exit = true;
       } else if (e.type == SDL_KEYDOWN) {
@@ -285,7 +567,7 @@ void Game::Main() {
           case GameState::kHelp:
             if (key == SDLK_RETURN) {
               help_page_count_++;
-              if (help_page_count_ >= kHelpTexts.size()) {
+              if (help_page_count_ >= kHelpPageCount) {
                 help_page_count_ = 0;
                 state_ = GameState::kSelectDevice;
               }
@@ -296,6 +578,9 @@ void Game::Main() {
             exit = true;
             break;
           case GameState::kSelectDevice:
+            if (audio_source_ != nullptr) {
+              break;
+            }
             result = GetNumberOfKey(key);
             if (result != -1) {
               recorder_.ActivateRecorderDevice(result);
@@ -305,45 +590,41 @@ void Game::Main() {
             break;
           case GameState::kRecordingMinimumVolume:
             if (key == SDLK_RETURN) {
-              recorder_.StartRecording();
+              StartCalibration(kNoiseFloorQuantile, kCalibrationMaxWindows);
             }
             break;
           case GameState::kRecordingMaximumVolume:
             if (key == SDLK_RETURN) {
-              temp_timer_ = SDL_GetTicks();
+              StartCalibration(kPeakQuantile, kPeakMaxWindows);
             }
             break;
           case GameState::kReadyForGame:
           case GameState::kGameEnd:
             if (key == SDLK_RETURN) {
+              // 模拟线程启动后就是拍手事件唯一的消费者
+              recorder_.DropOnsets();
               StartNewGame();
-              recorder_.StopRecording();
-              recorder_.DropRecordingResult();
-              recorder_.StartRecording();
             }
             break;
         }
       }
 
+#ifdef HAKUSYU_PROFILE
+      if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3 &&
+          e.key.repeat == 0) {
+        show_profiler_overlay_ = !show_profiler_overlay_;
+      }
+#endif
+
 #ifdef _DEBUG_GAME
       if (state_ == GameState::kGaming && e.type == SDL_KEYDOWN &&
           e.key.repeat == 0) {
-        switch (e.key.keysym.sym) {
-          case SDLK_KP_0:
-            ShiftBlocks(3);
-            break;
-          case SDLK_KP_1:
-            physics_object_.ApplyVelocity(0.0, -1000.0);
-            break;
-          case SDLK_KP_2:
-            physics_object_.ApplyVelocity(-500.0, 0.0);
-            break;
-        }
+        debug_keys_.Push(e.key.keysym.sym);
       }
 #endif
     }
 
-    recorder_.FrameUpdate();
+    FinishAssetLoading(false);
 
     switch (state_) {
       case GameState::kHelp:
@@ -353,7 +634,11 @@ void Game::Main() {
         }
         break;
       case GameState::kSelectDevice:
-        if (need_rerender) {
+        if (audio_source_ != nullptr) {
+          recorder_.ActivateSource(std::move(audio_source_));
+          state_ = GameState::kRecordingMinimumVolume;
+          need_rerender = true;
+        } else if (need_rerender) {
           if (!RenderPromptToSelectRecorderDevices()) {
             state_ = GameState::KWaitingToExit;
           }
@@ -365,11 +650,10 @@ void Game::Main() {
           RenderTexts(kPromptRecordingMinimumVolume, true, kDefaultLineMargin);
           need_rerender = false;
         }
-        if (recorder_.HasStopped() && recorder_.GetAverageAmplitude() > 0) {
+        if (calibrating_ && UpdateCalibration()) {
           state_ = GameState::kRecordingMaximumVolume;
           need_rerender = true;
-          minimum_amplitude_ = recorder_.GetAverageAmplitude();
-          recorder_.DropRecordingResult();
+          minimum_amplitude_ = calibration_.GetEstimate();
         }
         break;
       case GameState::kRecordingMaximumVolume:
@@ -377,89 +661,62 @@ void Game::Main() {
           RenderTexts(kPromptRecordingMaximumVolume, true, kDefaultLineMargin);
           need_rerender = false;
         }
-        if (temp_timer_ != -1 && (SDL_GetTicks() - temp_timer_) > 2000) {
-          recorder_.StartRecording();
-          temp_timer_ = -1;
-        }
-        if (recorder_.HasStopped() && recorder_.GetAverageAmplitude() > 0) {
+        if (calibrating_ && UpdateCalibration()) {
           state_ = GameState::kReadyForGame;
           need_rerender = true;
-          maximum_amplitude_ = recorder_.GetAverageAmplitude();
-          recorder_.DropRecordingResult();
+          maximum_amplitude_ = calibration_.GetEstimate();
         }
         break;
       case GameState::kReadyForGame:
         if (need_rerender) {
-          auto texts_to_render = kPromptReadyForGame;
-          std::stringstream ss;
-          ss << std::setprecision(6) << "Minimum " << minimum_amplitude_
-             << " Maximum " << maximum_amplitude_ << " Slope "
-             << 1 / (maximum_amplitude_ - minimum_amplitude_);
-          texts_to_render.push_back(ss.str());
+          TextLines texts_to_render = kPromptReadyForGame;
+          texts_to_render.Format(
+              "Minimum %g Maximum %g Slope %g", minimum_amplitude_,
+              maximum_amplitude_,
+              1 / (maximum_amplitude_ - minimum_amplitude_));
           RenderTexts(texts_to_render, true, kDefaultLineMargin);
           need_rerender = false;
         }
         break;
       case GameState::kGameEnd:
         if (need_rerender) {
-          auto texts_to_render = kPromptGameEnd;
-          texts_to_render.push_back(std::to_string(score_));
+          TextLines texts_to_render = kPromptGameEnd;
+          texts_to_render.Format("%d", session_.GetScore());
+          texts_to_render.Format("Level seed %llu",
+                                 static_cast<unsigned long long>(level_seed_));
           RenderTexts(texts_to_render, true, kDefaultLineMargin);
           need_rerender = false;
         }
         break;
-      case GameState::kGaming:
-        if (gCurrentRecordingBufferPosition >
-            recorder_.GetSuggestClipPosition()) {
-          recorder_.StopRecording();
-        } else {
-          continue;
-        }
-        const float sys_amplitude = recorder_.GetAverageAmplitude();
-        const float relative_amplitude = GetRelativeAmplitude(sys_amplitude);
-        // float relative_amplitude = kSimulateRelativeAmplitude;
-        const float vertical_speed =
-            -relative_amplitude * kRelativeAmplitudeToVerticalSpeed;
-        const float horizontal_speed =
-            relative_amplitude * kRelativeAmplitudeToHorizontalSpeed;
-        physics_object_.ApplyVelocity(horizontal_speed, vertical_speed);
-        HitDetectionResult r = physics_object_.Update(blocks_);
-        if (r.hit_lower_border || r.hit_upper_border) {
+      case GameState::kGaming: {
+        snapshots_.Update();
+        const WorldSnapshot &snapshot = snapshots_.GetFrontBuffer();
+        if (snapshot.ended) {
+          StopSimulation();
           state_ = GameState::kGameEnd;
           need_rerender = true;
+          break;
         }
-        if (r.hit_block_id != -1) {
-          if (!blocks_hit_state_[r.hit_block_id]) {
-            for (int i = 0; i <= r.hit_block_id - 1; i++) {
-              if (!blocks_hit_state_[i]) {
-                state_ = GameState::kGameEnd;
-                need_rerender = true;
-                goto main_loop_begin;
-              }
-            }
-            blocks_hit_state_[r.hit_block_id] = true;
-            score_++;
-          }
-        }
-        ShiftBlocks(physics_object_.GetDeltaX());
-        GamingDraw(relative_amplitude);
-        if (recorder_.CanStartRecording()) {
-          recorder_.StartRecording();
-        }
+        GamingDraw(snapshot);
+        HAKUSYU_PROFILE_END_FRAME();
+#ifdef HAKUSYU_CHECK_ALLOCATIONS
+        CheckFrameAllocations();
+#endif
         break;
+      }
     }
   }
 }
 
-void Game::RenderTexts(const std::vector<std::string> &texts, bool is_centering,
-                       int margin, bool standalone) {
+void Game::RenderTexts(const TextLines &texts, bool is_centering, int margin,
+                       bool standalone) {
   if (standalone) {
     SDL_SetRenderDrawColor(renderer_, 0xFF, 0xFF, 0xFF, 0xFF);
     SDL_RenderClear(renderer_);
   }
   int y_offset = 0;
-  for (const std::string &text : texts) {
-    auto r = GetTextTexture(text.c_str());
+  for (int i = 0; i < texts.GetSize(); i++) {
+    auto r = text_cache_.Get(texts.Get(i));
     SDL_Texture *texture = std::get<0>(r);
     SDL_Rect target_rect = std::get<1>(r);
     if (is_centering) {
@@ -471,179 +728,111 @@ void Game::RenderTexts(const std::vector<std::string> &texts, bool is_centering,
     y_offset += target_rect.h + margin;
 
     SDL_RenderCopy(renderer_, texture, nullptr, &target_rect);
-    SDL_DestroyTexture(texture);
   }
   if (standalone) {
     SDL_RenderPresent(renderer_);
+    if (!first_frame_presented_) {
+      first_frame_presented_ = true;
+      ReportStartupTime("First frame");
+    }
   }
 }
 
-void Game::GamingDraw(float relative_amplitude) {
-  SDL_SetRenderDrawColor(renderer_, 0xFF, 0xFF, 0xFF, 0xFF);
-  SDL_RenderClear(renderer_);
-
-  RenderTexts(
-      {std::to_string(static_cast<int>(std::floor(relative_amplitude * 100)))},
-      false, 0, false);
-
-  SDL_Rect character_box = physics_object_.GetBox();
-  const SDL_Rect &first_block = blocks_.front();
-  SDL_Rect character_render_rect = character_box;
-  // character_render_rect.x = kCharacterPosition;
-  SDL_RenderCopy(renderer_, character_texture_, nullptr,
-                 &character_render_rect);
-
-  for (size_t i = 0; i < blocks_.size(); i++) {
-    SDL_Color c = blocks_hit_state_[i] ? kHitBlockColor : kNotHitBlockColor;
-    SDL_SetRenderDrawColor(renderer_, c.r, c.g, c.b, c.a);
-    SDL_RenderFillRect(renderer_, &blocks_[i]);
+void Game::GamingDraw(const WorldSnapshot &snapshot) {
+  {
+    HAKUSYU_PROFILE_SCOPE(ProfileStage::kDraw);
+    GamingDrawScene(snapshot);
   }
-
+  HAKUSYU_PROFILE_SCOPE(ProfileStage::kPresent);
+#ifdef HAKUSYU_PROFILE
+  const Uint64 present_begin = SDL_GetPerformanceCounter();
   SDL_RenderPresent(renderer_);
+  LatencyTracer::Get().AddFrame(
+      {snapshot.capture_timestamp, snapshot.amplitude_timestamp,
+       snapshot.physics_timestamp, present_begin, SDL_GetPerformanceCounter()});
+#else
+  SDL_RenderPresent(renderer_);
+#endif
 }
 
-void Game::ShiftBlocks(int pixels) {
-  SDL_Rect *front = &blocks_.front();
-  if (front->x + front->w <= 0) {
-    GenNewBlock();
-    blocks_.pop_front();
-    blocks_hit_state_.pop_front();
-    front = &blocks_.front();
-  }
-  for (SDL_Rect &block : blocks_) {
-    block.x -= pixels;
-  }
-}
+void Game::GamingDrawScene(const WorldSnapshot &snapshot) {
+  SDL_SetRenderDrawColor(renderer_, 0xFF, 0xFF, 0xFF, 0xFF);
+  SDL_RenderClear(renderer_);
 
-void Game::GenNewBlock() {
-  const int min_height = static_cast<int>(0.2 * window_height_);
-  const int max_height = static_cast<int>(0.6 * window_height_);
-  const int block_width = static_cast<int>(window_width_ / division);
-  const int min_width = static_cast<int>(0.3 * block_width);
-  const int max_width = static_cast<int>(0.6 * block_width);
+  // 方块在最下层，然后是角色和文字，绘制次数与可见方块数量无关
+  for (size_t i = 0; i < snapshot.blocks.size(); i++) {
+    SDL_Color c = i < snapshot.hit_blocks ? kHitBlockColor : kNotHitBlockColor;
+    SDL_Rect block = snapshot.blocks[i];
+    block.x -= snapshot.camera_x;
+    render_batch_.AddRect(c, block);
+  }
+
+  // 画面比模拟晚一个步长，在最近两步之间插值
+  const float alpha = std::clamp(
+      static_cast<float>((clock_->GetSeconds() - snapshot.time) /
+                         kPhysicsTimeStep),
+      0.0f, 1.0f);
+  SDL_Rect character_render_rect = snapshot.character_box;
+  character_render_rect.y = static_cast<int>(std::floor(
+      snapshot.previous_character_y +
+      (snapshot.character_box.y - snapshot.previous_character_y) * alpha));
+  // character_render_rect.x = kCharacterPosition;
+  render_batch_.AddTexture(character_texture_, nullptr,
+                           character_render_rect);
 
-  int offset = 0;
-  if (!blocks_.empty()) {
-    offset = blocks_.back().x + blocks_.back().w;
-  }
-  std::uniform_int_distribution<int> width_gen(min_width, max_width);
-  std::uniform_int_distribution<int> height_gen(min_height, max_height);
-  int width = width_gen(rng), height = height_gen(rng);
-  SDL_Rect block;
-  block.w = width;
-  block.h = height;
-  block.x = block_width - width + offset;
-  block.y = window_height_ - block.h;
-  blocks_.push_back(block);
-  blocks_hit_state_.push_back(false);
-}
+  char amplitude_text[16];
+  SDL_snprintf(amplitude_text, sizeof(amplitude_text), "%d",
+               static_cast<int>(std::floor(snapshot.relative_amplitude * 100)));
+  glyph_atlas_.DrawText(&render_batch_, amplitude_text, 0, 0);
 
-std::tuple<SDL_Texture *, SDL_Rect> Game::GetTextTexture(const char *text) {
-  SDL_Surface *s = TTF_RenderText_Solid(font_, text, kDefaultTextColor);
-  if (s == nullptr) {
-    throw GameError(TTF_GetError());
-  }
-  SDL_Texture *t = SDL_CreateTextureFromSurface(renderer_, s);
-  if (t == nullptr) {
-    throw GameError(SDL_GetError());
+  if (show_profiler_overlay_) {
+    DrawProfilerOverlay();
   }
-  SDL_Rect size = {0, 0, s->w, s->h};
-  SDL_FreeSurface(s);
-  return std::make_tuple(t, size);
-}
-
-void PhysicsObject::Init(const SDL_Rect &box) {
-  ResetAllVariables();
-  timer_ = SDL_GetTicks();
-  box_ = box;
+  draw_calls_ = render_batch_.Flush(renderer_);
 }
 
-void PhysicsObject::ApplyForce(float f_x, float f_y) {
-  f_x_ += f_x;
-  f_y_ += f_y;
-}
-
-void PhysicsObject::ApplyVelocity(float v_x, float v_y) {
-  v_x_ += v_x;
-  v_y_ += v_y;
-}
-
-void PhysicsObject::SetFriction(float friction_x, float friction_y) {
-  friction_x_ = friction_x;
-  friction_y_ = friction_y;
-}
-
-HitDetectionResult PhysicsObject::Update(const std::deque<SDL_Rect> &blocks) {
-  HitDetectionResult hit_detection_result;
-  Uint32 current = SDL_GetTicks();
-  float dt = (current - timer_) / 1000.0f;
-  timer_ = current;
-
-  float new_v_x = v_x_ + (f_x_ - Sign(v_x_) * friction_x_ * v_x_ * v_x_) * dt;
-  float new_v_y = v_y_ + (f_y_ - Sign(v_y_) * friction_y_ * v_y_ * v_y_) * dt;
-
-  int new_x = static_cast<int>(box_.x + (new_v_x + v_x_) * 0.5 * dt);
-  int new_y = static_cast<int>(box_.y + (new_v_y + v_y_) * 0.5 * dt);
-
-  {
-    SDL_Rect new_box = {new_x, box_.y, box_.w, box_.h};
-    for (size_t i = 0; i < blocks.size(); i++) {
-      int result = CheckBoxCollision(new_box, blocks[i]);
-      if (result == kCollisionBoth) {
-        hit_detection_result.hit_block_id = i;
-        new_x = box_.x;
-        if (result & kCollisionX) {
-          new_v_x = 0;
-        }
-        break;
-      }
-    }
+void Game::CheckFrameAllocations() {
+  // 计数包括模拟线程，两个线程在稳态下都不应该分配
+  const Uint64 count = GetAllocationCount();
+  if (gaming_frames_ >= kAllocationCheckWarmupFrames &&
+      count != frame_allocation_count_) {
+    throw GameError("A gameplay frame allocated heap memory");
   }
-
-  {
-    SDL_Rect new_box = {box_.x, new_y, box_.w, box_.h};
-    for (size_t i = 0; i < blocks.size(); i++) {
-      int result = CheckBoxCollision(new_box, blocks[i]);
-      if (result == kCollisionBoth) {
-        hit_detection_result.hit_block_id = i;
-        new_y = box_.y;
-        if (result & kCollisionY) {
-          new_v_y = 0;
-        }
-        break;
-      }
-    }
-  }
-
-  delta_x_ = new_x - box_.x;
-  delta_y_ = new_y - box_.y;
-  // box_.x = new_x;
-  box_.y = new_y;
-  v_x_ = new_v_x;
-  v_y_ = new_v_y;
-
-  if (box_.y >= kWindowHeight) {
-    hit_detection_result.hit_lower_border = true;
-    ;
-  }
-  if (box_.y <= 0) {
-    hit_detection_result.hit_upper_border = true;
-  }
-
-  return hit_detection_result;
+  frame_allocation_count_ = count;
+  gaming_frames_++;
 }
 
-int PhysicsObject::GetDeltaX() { return delta_x_; }
-
-int PhysicsObject::GetDeltaY() { return delta_y_; }
-
-SDL_Rect PhysicsObject::GetBox() { return box_; }
-
-void PhysicsObject::ResetAllVariables() {
-  f_x_ = 0, f_y_ = 0;
-  v_x_ = 0, v_y_ = 0;
-  delta_x_ = 0, delta_y_ = 0;
-  friction_x_ = 0, friction_y_ = 0;
+void Game::DrawProfilerOverlay() {
+  FrameProfiler &profiler = FrameProfiler::Get();
+  int y = 0;
+  char line[64];
+  for (int s = 0; s < kProfileStageCount; s++) {
+    const ProfileStage stage = static_cast<ProfileStage>(s);
+    SDL_snprintf(line, sizeof(line), "%-12s p50 %6.3f p99 %6.3f ms",
+                 FrameProfiler::GetStageName(stage),
+                 profiler.GetPercentile(stage, 0.5f),
+                 profiler.GetPercentile(stage, 0.99f));
+    glyph_atlas_.DrawText(&render_batch_, line, kWindowWidth / 2, y);
+    y += glyph_atlas_.GetLineHeight();
+  }
+  // 上一帧的数字，本帧的批次还没有提交
+  SDL_snprintf(line, sizeof(line), "draw calls %d", draw_calls_);
+  glyph_atlas_.DrawText(&render_batch_, line, kWindowWidth / 2, y);
+  y += glyph_atlas_.GetLineHeight();
+  // 各频带的电平，低频在左，满量程是100
+  int length = SDL_snprintf(line, sizeof(line), "%-12s", "bands");
+  for (int b = 0; b < kBandCount; b++) {
+    length += SDL_snprintf(
+        line + length, sizeof(line) - length, " %3d",
+        static_cast<int>(std::min(recorder_.GetBandLevel(b) * 100, 999.0f)));
+  }
+  glyph_atlas_.DrawText(&render_batch_, line, kWindowWidth / 2, y);
+  y += glyph_atlas_.GetLineHeight();
+  LatencyTracer &tracer = LatencyTracer::Get();
+  SDL_snprintf(line, sizeof(line), "%-12s p50 %6.2f p99 %6.2f ms", "latency",
+               tracer.GetPercentile(LatencySegment::kSoundToPhoton, 0.5f),
+               tracer.GetPercentile(LatencySegment::kSoundToPhoton, 0.99f));
+  glyph_atlas_.DrawText(&render_batch_, line, kWindowWidth / 2, y);
 }
 
 std::vector<std::string> Recorder::GetRecorderDevices() {
@@ -655,103 +844,137 @@ std::vector<std::string> Recorder::GetRecorderDevices() {
   return result;
 }
 
-void AudioRecordingCallback_(void *userdata, Uint8 *stream, int len) {
-  std::memcpy(&gCurrentRecordingBuffer[gCurrentRecordingBufferPosition], stream,
-              len);
-  gCurrentRecordingBufferPosition += len;
-}
-
-Recorder::~Recorder() {
-  delete[] buffer_;
-  gCurrentRecordingBuffer = nullptr;
-  gCurrentRecordingBufferPosition = 0;
+void Recorder::AudioRecordingCallback_(void *userdata, const Uint8 *stream,
+                                       int len) {
+  const Uint64 timestamp = SDL_GetPerformanceCounter();
+  auto recorder = static_cast<Recorder *>(userdata);
+  auto samples = reinterpret_cast<const Sint16 *>(stream);
+  const size_t frames =
+      len / sizeof(Sint16) / recorder->recording_audio_spec_.channels;
+  // 响度和起音检测只看降采样后的单声道
+  float *analysis = recorder->analysis_buffer_.data();
+  const size_t analysis_count =
+      recorder->preprocessor_.Process(samples, frames, analysis);
+  float *band_levels = recorder->band_buffer_.data();
+  recorder->band_analyzer_.Process(analysis, analysis_count, band_levels);
+  // 只看拍手频带时响度跟着频带的电平走，校准和相对振幅都不用改
+  recorder->loudness_meter_.Process(
+      recorder->band_config_.clap_band_only ? band_levels : analysis,
+      analysis_count);
+  // 起音强度也要和校准用同一个量，所以输入跟着响度一起切换
+  if (recorder->onset_detector_.Process(
+          recorder->band_config_.clap_band_only ? band_levels : analysis,
+          analysis_count, timestamp) > 0) {
+    recorder->PushAudioEvent(AudioEventCode::kOnset);
+  }
+  // 放在处理之后，读到这个时间戳的线程也能看到这一块的响度
+  recorder->capture_timestamp_.store(timestamp, std::memory_order_release);
 }
 
-void Recorder::ActivateRecorderDevice(int index) {
-  SDL_AudioSpec desired_audio_spec;
-  SDL_zero(desired_audio_spec);
-  // following is recommended arguments for most platforms
-  desired_audio_spec.freq = 44100;
-  desired_audio_spec.format = AUDIO_S16;
-  desired_audio_spec.channels = 2;
-  desired_audio_spec.samples = 4096;
-  desired_audio_spec.callback = AudioRecordingCallback_;
-  id_ = SDL_OpenAudioDevice(
-      SDL_GetAudioDeviceName(index, SDL_TRUE), SDL_TRUE, &desired_audio_spec,
-      &recording_audio_spec_,
-      SDL_AUDIO_ALLOW_ANY_CHANGE & ~SDL_AUDIO_ALLOW_FORMAT_CHANGE);
-  if (id_ == 0) {
-    throw GameError(SDL_GetError());
+void Recorder::PushAudioEvent(AudioEventCode code) {
+  if (audio_event_type_ == 0 || audio_event_type_ == static_cast<Uint32>(-1)) {
+    return;
   }
+  SDL_Event event;
+  SDL_zero(event);
+  event.type = audio_event_type_;
+  event.user.code = static_cast<Sint32>(code);
+  SDL_PushEvent(&event);
+}
 
-  current_index_ = index;
+Recorder::~Recorder() {
+  // 先停掉输入源，回调不会再访问下面的缓冲区
+  source_.reset();
+}
 
-  const int bytes_per_sample =
-      recording_audio_spec_.channels *
-      (SDL_AUDIO_BITSIZE(recording_audio_spec_.format) / 8);
-  const int bytes_per_second = recording_audio_spec_.freq * bytes_per_sample;
-  buffer_size_ = kBufferRecordTime * bytes_per_second;
-  max_buffer_position_ = kMaxRecordTime * bytes_per_second;
-  suggest_clip_position_ =
-      static_cast<size_t>(kSuggestClipTime / 1000.0 * bytes_per_second);
+void Recorder::SetCaptureFrames(int capture_frames, int onset_hop_frames) {
+  capture_frames_ = capture_frames;
+  onset_hop_frames_ = onset_hop_frames;
+}
 
-  buffer_ = new Uint8[buffer_size_];
+void Recorder::SetPreprocessing(const PreprocessConfig &config) {
+  preprocess_config_ = config;
+}
 
-  gCurrentRecordingBuffer = buffer_;
-  gCurrentRecordingBufferPosition = 0;
-  state_ = RecordingStates::kNotRecorded;
+void Recorder::SetBandAnalysis(const BandConfig &config) {
+  band_config_ = config;
 }
 
-void Recorder::StartRecording() {
-  SDL_PauseAudioDevice(id_, SDL_FALSE);
-  state_ = RecordingStates::kRecording;
-  gCurrentRecordingBuffer = buffer_;
-  gCurrentRecordingBufferPosition = 0;
+void Recorder::ActivateRecorderDevice(int index) {
+  ActivateSource(std::make_unique<MicrophoneSource>(index));
 }
 
-void Recorder::StopRecording() {
-  SDL_PauseAudioDevice(id_, SDL_TRUE);
-  state_ = RecordingStates::kStopped;
-  buffer_position_ = gCurrentRecordingBufferPosition;
+void Recorder::ActivateSource(std::unique_ptr<AudioSource> source) {
+  source_.reset();
+  source->Open(capture_frames_, &recording_audio_spec_);
+  source_ = std::move(source);
+  if (audio_event_type_ == 0) {
+    audio_event_type_ = SDL_RegisterEvents(1);
+  }
+
+  preprocessor_.Init(recording_audio_spec_.channels, recording_audio_spec_.freq,
+                     recording_audio_spec_.samples, preprocess_config_);
+  analysis_buffer_.assign(preprocessor_.GetMaxOutput(), 0.0f);
+  const int analysis_rate = preprocessor_.GetOutputRate();
+  band_analyzer_.Init(analysis_rate, band_config_);
+  band_buffer_.assign(preprocessor_.GetMaxOutput(), 0.0f);
+  loudness_meter_.Init(analysis_rate, kLoudnessHistoryTime);
+  loudness_meter_.SetWindow(kLoudnessWindowTime);
+  const int onset_hop =
+      onset_hop_frames_ * analysis_rate / recording_audio_spec_.freq;
+  onset_detector_.Init(analysis_rate, onset_hop, band_config_.clap_band_only);
+
+  source_->Start(AudioRecordingCallback_, this);
 }
 
-void Recorder::FrameUpdate() {
-  if (state_ == RecordingStates::kRecording) {
-    SDL_LockAudioDevice(id_);
-    if (gCurrentRecordingBufferPosition > max_buffer_position_) {
-      StopRecording();
-    }
-    SDL_UnlockAudioDevice(id_);
-  }
+float Recorder::GetLoudness() { return loudness_meter_.GetLoudness(); }
+
+void Recorder::SetLoudnessWindow(int milliseconds) {
+  loudness_meter_.SetWindow(milliseconds);
 }
 
-bool Recorder::CanStartRecording() {
-  return state_ == RecordingStates::kNotRecorded ||
-         state_ == RecordingStates::kStopped;
+bool Recorder::PollOnset(OnsetEvent *event) {
+  return onset_detector_.PollEvent(event);
 }
 
-bool Recorder::HasStopped() { return state_ == RecordingStates::kStopped; }
+void Recorder::DropOnsets() { onset_detector_.DropEvents(); }
 
-float Recorder::GetAverageAmplitude() {
-  int16_t *samples = reinterpret_cast<int16_t *>(buffer_);
-  size_t sample_count = buffer_position_ / sizeof(int16_t);
-  if (sample_count == 0) {
-    return 0.0f;
-  }
+float Recorder::GetCallbackPeriod() {
+  return onset_detector_.GetCallbackPeriod();
+}
 
-  float total_amplitude = 0;
-  for (size_t i = 0; i < sample_count; i++) {
-    total_amplitude += std::abs(samples[i]);
-  }
-  return total_amplitude / sample_count;
+float Recorder::GetBandLevel(int band) {
+  return band_analyzer_.GetBandLevel(band);
 }
 
-void Recorder::DropRecordingResult() { buffer_position_ = 0; }
+Uint64 Recorder::GetCaptureTimestamp() {
+  return capture_timestamp_.load(std::memory_order_acquire);
+}
 
-size_t Recorder::GetSuggestClipPosition() { return suggest_clip_position_; }
+Uint64 Recorder::GetLoudnessCursor() { return loudness_meter_.GetCursor(); }
+
+int Recorder::ReadLoudnessWindows(Uint64 *cursor, float *values,
+                                  int max_count) {
+  return loudness_meter_.ReadWindows(cursor, values, max_count);
+}
 
 void Game::Exit() {
+  StopSimulation();
+  replay_writer_.Close();
+  if (asset_thread_.joinable()) {
+    asset_thread_.join();
+  }
+  SDL_FreeSurface(character_surface_);
+  TTF_CloseFont(atlas_font_);
+#ifdef HAKUSYU_PROFILE
+  FrameProfiler::Get().WriteCsv(kProfileCsvPath);
+  LatencyTracer::Get().LogSummary();
+  LatencyTracer::Get().WriteCsv(kLatencyCsvPath);
+  LatencyTracer::Get().WriteTrace(kLatencyTracePath);
+#endif
   SDL_DestroyTexture(character_texture_);
+  text_cache_.Clear();
+  glyph_atlas_.Destroy();
   TTF_CloseFont(font_);
   SDL_DestroyWindow(window_);
 
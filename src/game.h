@@ -3,22 +3,35 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 
+#include <atomic>
+#include <exception>
+#include <memory>
 #include <queue>
 #include <stdexcept>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
-class GameError : public std::runtime_error {
- public:
-  GameError(const char *message) : std::runtime_error(message) {}
-};
-
-enum class RecordingStates {
-  kNotOpenDevice,
-  kNotRecorded,
-  kStopped,
-  kRecording,
+#include "audio_source.h"
+#include "band_analyzer.h"
+#include "calibration.h"
+#include "capture_preprocessor.h"
+#include "clock.h"
+#include "game_error.h"
+#include "loudness_meter.h"
+#include "onset_detector.h"
+#include "physics.h"
+#include "render_batch.h"
+#include "replay.h"
+#include "session.h"
+#include "spsc_queue.h"
+#include "text_renderer.h"
+#include "triple_buffer.h"
+
+// Codes of the SDL user event the audio thread pushes to wake the game thread
+enum class AudioEventCode {
+  kOnset,
 };
 
 class Recorder {
@@ -27,53 +40,56 @@ class Recorder {
 
   ~Recorder();
 
+  // Must be called before activating a source. Smaller callbacks lower the
+  // sound-to-jump latency at the cost of more callback overhead.
+  void SetCaptureFrames(int capture_frames, int onset_hop_frames);
+  // Must be called before activating a source. Loudness and onsets are
+  // computed on the preprocessed mono stream.
+  void SetPreprocessing(const PreprocessConfig &config);
+  // Must be called before activating a source
+  void SetBandAnalysis(const BandConfig &config);
+  // The device keeps capturing into the ring buffer from now on
   void ActivateRecorderDevice(int index);
-  void StartRecording();
-  void StopRecording();
-  // This function must be called every frame
-  void FrameUpdate();
-  bool CanStartRecording();
-  bool HasStopped();
-  float GetAverageAmplitude();
-  void DropRecordingResult();
-  size_t GetSuggestClipPosition();
+  // Same as above for any input source, e.g. a WAV file or synthetic audio
+  void ActivateSource(std::unique_ptr<AudioSource> source);
+  // Mean absolute amplitude of the newest sliding window, O(1) and lock-free
+  float GetLoudness();
+  void SetLoudnessWindow(int milliseconds);
+  // Clap onsets detected on the audio thread, oldest first
+  bool PollOnset(OnsetEvent *event);
+  void DropOnsets();
+  // Measured seconds between two audio callbacks
+  float GetCallbackPeriod();
+  // RMS level of one band of the newest spectrum, in [0, 1]
+  float GetBandLevel(int band);
+  // SDL_GetPerformanceCounter at the start of the newest callback whose audio
+  // is visible to GetLoudness and PollOnset, 0 before the first one
+  Uint64 GetCaptureTimestamp();
+  // Loudness windows captured after *cursor, see LoudnessMeter::ReadWindows
+  Uint64 GetLoudnessCursor();
+  int ReadLoudnessWindows(Uint64 *cursor, float *values, int max_count);
 
  private:
-  RecordingStates state_ = RecordingStates::kNotOpenDevice;
-  int current_index_ = -1;
-  int id_;
-  SDL_AudioSpec recording_audio_spec_;
-  size_t buffer_size_, max_buffer_position_, buffer_position_,
-      suggest_clip_position_;
-  Uint8 *buffer_ = nullptr;
-};
-
-struct HitDetectionResult {
-  bool hit_lower_border = false;
-  bool hit_upper_border = false;
-  int hit_block_id = -1;
-};
-
-class PhysicsObject {
- public:
-  void Init(const SDL_Rect &box);
-  void ApplyForce(float f_x, float f_y);
-  void ApplyVelocity(float v_x, float v_y);
-  void SetFriction(float friction_x, float friction_y);
-  HitDetectionResult Update(const std::deque<SDL_Rect> &blocks);
-  int GetDeltaX();
-  int GetDeltaY();
-  SDL_Rect GetBox();
+  static void AudioRecordingCallback_(void *userdata, const Uint8 *stream,
+                                      int len);
+  void PushAudioEvent(AudioEventCode code);
 
- private:
-  void ResetAllVariables();
-
-  Uint32 timer_;
-  float f_x_, f_y_;
-  float v_x_, v_y_;
-  int delta_x_, delta_y_;
-  float friction_x_, friction_y_;
-  SDL_Rect box_;
+  std::unique_ptr<AudioSource> source_;
+  SDL_AudioSpec recording_audio_spec_;
+  int capture_frames_ = 256;
+  int onset_hop_frames_ = 128;
+  PreprocessConfig preprocess_config_;
+  BandConfig band_config_;
+  std::atomic<Uint64> capture_timestamp_{0};
+  Uint32 audio_event_type_ = 0;
+  CapturePreprocessor preprocessor_;
+  // Output of the preprocessor for one callback, audio thread only
+  std::vector<float> analysis_buffer_;
+  BandAnalyzer band_analyzer_;
+  // Clap band level per analysis sample, audio thread only
+  std::vector<float> band_buffer_;
+  LoudnessMeter loudness_meter_;
+  OnsetDetector onset_detector_;
 };
 
 enum class GameState {
@@ -91,6 +107,22 @@ class Game {
  public:
   static void SetupEnvironment();
 
+  Game();
+  ~Game();
+
+  // Replaces the high-resolution clock that drives the physics
+  void SetClock(Clock *clock);
+  // Plays the same level every game instead of a random one
+  void SetLevelSeed(Uint64 seed);
+  // Uses this source instead of asking the player to pick a recorder device.
+  // A source that does not play in real time also replaces the clock.
+  void SetAudioSource(std::unique_ptr<AudioSource> source);
+  // Appends every game to a replay log, see HakusyuHeadless --replay
+  void SetReplayLog(const char *path);
+  // Drives the character from this band of the spectrum only, so speech,
+  // fans and music below it are ignored. Must be called before Init.
+  void SetClapBand(float low_hz, float high_hz);
+
   void Init();
 
   void Main();
@@ -98,15 +130,36 @@ class Game {
   void Exit();
 
  private:
-  void RenderTexts(const std::vector<std::string> &texts, bool is_centering,
-                   int margin, bool standalone = true);
-  void GamingDraw(float relative_amplitude);
-  void ShiftBlocks(int pixels);
-  void GenNewBlock();
+  void RenderTexts(const TextLines &texts, bool is_centering, int margin,
+                   bool standalone = true);
+  void GamingDraw(const WorldSnapshot &snapshot);
+  void GamingDrawScene(const WorldSnapshot &snapshot);
+  void DrawProfilerOverlay();
+  // With HAKUSYU_CHECK_ALLOCATIONS, throws if a frame after the warm-up
+  // allocated on the heap
+  void CheckFrameAllocations();
+  // Body of the asset thread: decodes the sprite and rasterizes the glyphs
+  void LoadAssets();
+  // Render thread, uploads the textures once the asset thread is done and
+  // returns whether they are ready. With wait it blocks until then.
+  bool FinishAssetLoading(bool wait);
   void StartNewGame();
+  // Body of the simulation thread, runs until the game ends or is stopped
+  void SimulationMain();
+  // Simulation thread, debug keys that also go to the replay log
+  void ApplyDebugShift(int pixels);
+  void ApplyDebugVelocity(float v_x, float v_y);
+  void StopSimulation();
   bool RenderPromptToSelectRecorderDevices();
+  // How long the main loop may block waiting for the next event
+  int GetEventWaitTimeout();
   float GetRelativeAmplitude(float real_amplitude);
-  std::tuple<SDL_Texture *, SDL_Rect> GetTextTexture(const char *text);
+  void StartCalibration(float quantile, int max_windows);
+  // Feeds new loudness windows to the calibration, true once it converged
+  bool UpdateCalibration();
+  // Simulation thread, follows the background level during a game and
+  // updates noise_floor_offset_
+  void UpdateNoiseFloor();
 
   GameState state_ = GameState::kHelp;
   int window_width_;
@@ -116,13 +169,50 @@ class Game {
   SDL_Texture *character_texture_ = nullptr;
   SDL_Rect character_texture_wh_;
   TTF_Font *font_ = nullptr;
-  std::deque<SDL_Rect> blocks_;
-  std::deque<bool> blocks_hit_state_;
-  PhysicsObject physics_object_;
+  // 加载线程专用的字体实例，font_同时在渲染提示页面
+  TTF_Font *atlas_font_ = nullptr;
+  GlyphAtlas glyph_atlas_;
+  RenderBatch render_batch_;
+  int draw_calls_ = 0;
+  TextTextureCache text_cache_;
+  // 游戏进行时session_和physics_timestep_只由模拟线程访问
+  GameSession session_;
+  Uint64 level_seed_ = 0;
+  bool has_fixed_level_seed_ = false;
+  PerformanceClock performance_clock_;
+  Clock *clock_;
+  FixedTimestep physics_timestep_;
+  std::thread simulation_thread_;
+  std::atomic<bool> simulation_running_{false};
+  // Written by the simulation thread during a game
+  ReplayWriter replay_writer_;
+  TripleBuffer<WorldSnapshot> snapshots_;
+  // Debug keys forwarded from the event loop to the simulation thread
+  SpscQueue<SDL_Keycode, 16> debug_keys_;
+  // Pushed by the simulation and asset threads to wake the event loop
+  Uint32 wake_event_type_ = 0;
+  std::thread asset_thread_;
+  std::atomic<bool> assets_decoded_{false};
+  // Set by the asset thread, rethrown on the render thread
+  std::exception_ptr asset_error_;
+  SDL_Surface *character_surface_ = nullptr;
+  bool assets_ready_ = false;
+  bool first_frame_presented_ = false;
+  int gaming_frames_ = 0;
+  Uint64 frame_allocation_count_ = 0;
   Recorder recorder_;
+  std::unique_ptr<AudioSource> audio_source_;
   int help_page_count_ = 0;
   bool need_rerender = true;
-  Uint32 temp_timer_ = -1;
+  bool has_vsync_ = false;
+  bool show_profiler_overlay_ = false;
+  bool calibrating_ = false;
+  CalibrationEstimator calibration_;
+  NoiseFloorTracker noise_floor_;
+  // Tracked noise floor minus the calibrated minimum, simulation thread only
+  // during a game
+  float noise_floor_offset_ = 0.0f;
+  Uint64 loudness_cursor_ = 0;
+  // Set by calibration, never changed by the noise floor tracking
   float minimum_amplitude_, maximum_amplitude_;
-  int score_;
 };
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <stdexcept>
+
+class GameError : public std::runtime_error {
+ public:
+  GameError(const char *message) : std::runtime_error(message) {}
+};
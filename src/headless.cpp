@@ -0,0 +1,485 @@
+// 无窗口、无音频设备的模拟入口，用来在构建机上测量游戏逻辑的速度
+#define SDL_MAIN_HANDLED
+#include <SDL2/SDL.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "allocation_counter.h"
+#include "batch_runner.h"
+#include "config.h"
+#include "game_error.h"
+#include "physics_world.h"
+#include "replay.h"
+#include "triple_buffer.h"
+
+constexpr int kPhysicsBenchSteps = 240;
+constexpr int kPhysicsBenchBlocks = 64;
+// 粗步长斜着撞到方块的角，角色应当停在方块顶上继续前进
+constexpr SDL_Rect kCornerBlock = {200, 400, 100, 400};
+constexpr SDL_Rect kCornerBox = {100, 300, 50, 50};
+constexpr float kCornerVelocity = 1000.0f;
+constexpr float kCornerTimeStep = 0.1f;
+constexpr int kCornerSteps = 4;
+constexpr int kAllocationWarmupSteps = 240;
+constexpr int kAllocationCheckSteps = 240 * 60;
+// 录制时每次迭代推进的步数在1到这个值之间变化，模拟游戏里帧间隔的抖动
+constexpr int kRecordMaxStepsPerIteration = 6;
+constexpr int kRecordClapInterval = 45;
+
+struct HeadlessOptions {
+  int episodes = 100;
+  unsigned int seed = 1;
+  float max_episode_time = 120.0f;
+  int look_ahead = kLookAheadBlocks;
+  int threads = 0;
+  SessionParams params;
+  // Benchmarks PhysicsWorld against PhysicsObject instead of playing
+  int physics_bench_bodies = 0;
+  // Fails if a coarse step leaves the character inside a block
+  bool check_collisions = false;
+  // Fails if the steady-state gameplay step allocates
+  bool check_allocations = false;
+  // Writes the episodes to a replay log instead of running the batch
+  const char *record_path = nullptr;
+  // Plays back and verifies a replay log
+  const char *replay_path = nullptr;
+};
+
+#ifdef HAKUSYU_CHECK_ALLOCATIONS
+// 按游戏里模拟线程的方式推进一局，稳态下每一步都不应该分配堆内存
+// Starting a game may allocate (e.g. the level prefetch thread), so only the
+// steps are counted.
+int RunAllocationCheck(const HeadlessOptions &options) {
+  const BatchConfig defaults;
+  GameSession session;
+  session.SetParams(options.params);
+  RandomClapPolicy policy;
+  TripleBuffer<WorldSnapshot> snapshots;
+  Uint64 episode = 0;
+  auto start_episode = [&] {
+    session.Seed(options.seed + episode);
+    session.Start(defaults.character_width, defaults.character_height);
+    policy.Reset(options.seed * 7919u + episode);
+    episode++;
+  };
+  start_episode();
+
+  Uint64 allocations = 0;
+  for (int step = 0; step < kAllocationWarmupSteps + kAllocationCheckSteps;
+       step++) {
+    const Uint64 before = GetAllocationCount();
+    const float amplitude = policy.Next(session);
+    if (step % 60 == 0) {
+      session.ApplyClap(amplitude);
+    }
+    const bool running = session.Step(amplitude);
+    WorldSnapshot &snapshot = snapshots.GetBackBuffer();
+    session.FillSnapshot(&snapshot);
+    snapshots.Publish();
+    snapshots.Update();
+    if (step >= kAllocationWarmupSteps) {
+      allocations += GetAllocationCount() - before;
+    }
+    if (!running) {
+      start_episode();
+    }
+  }
+  std::printf("episodes:            %llu\n",
+              static_cast<unsigned long long>(episode));
+  std::printf("checked steps:       %d\n", kAllocationCheckSteps);
+  std::printf("heap allocations:    %llu\n",
+              static_cast<unsigned long long>(allocations));
+  return allocations == 0 ? 0 : 1;
+}
+#endif
+
+// 用随机拍手策略按游戏模拟线程的节奏录制几局，给回放做回归测试用
+int RunRecord(const HeadlessOptions &options) {
+  const BatchConfig defaults;
+  ReplayWriter writer;
+  writer.Open(options.record_path);
+  GameSession session;
+  session.SetLevelPrefetch(false);
+  session.SetParams(options.params);
+  RandomClapPolicy policy;
+  const long long max_steps = static_cast<long long>(
+      options.max_episode_time / options.params.time_step);
+  long long total_steps = 0;
+  for (int episode = 0; episode < options.episodes; episode++) {
+    session.Seed(options.seed + episode);
+    session.Start(defaults.character_width, defaults.character_height);
+    policy.Reset(options.seed * 7919u + episode);
+    writer.BeginGame(options.seed + episode, defaults.character_width,
+                     defaults.character_height, session.GetParams());
+    bool running = true;
+    long long steps = 0;
+    for (int iteration = 0; running && steps < max_steps; iteration++) {
+      const float amplitude = policy.Next(session);
+      if (iteration % kRecordClapInterval == 0) {
+        session.ApplyClap(amplitude);
+        writer.AddClap(amplitude);
+      }
+      const int count = 1 + iteration % kRecordMaxStepsPerIteration;
+      int executed = 0;
+      for (; executed < count && running; executed++) {
+        running = session.Step(amplitude);
+      }
+      writer.AddSteps(amplitude, executed);
+      steps += executed;
+    }
+    if (!running) {
+      writer.EndGame(session.GetScore(), session.GetCameraX(),
+                     session.GetPhysicsObject().GetBox());
+    }
+    total_steps += steps;
+  }
+  writer.Close();
+  std::printf("episodes:            %d\n", options.episodes);
+  std::printf("recorded steps:      %lld\n", total_steps);
+  return 0;
+}
+
+// 快进回放日志里的每一局，核对结束时的分数和角色位置
+int RunReplay(const HeadlessOptions &options) {
+  ReplayReader reader;
+  reader.Open(options.replay_path);
+  GameSession session;
+  session.SetLevelPrefetch(false);
+  int games = 0, verified = 0, mismatches = 0;
+  Uint64 total_steps = 0;
+  double simulated = 0.0;
+  const auto begin = std::chrono::steady_clock::now();
+  ReplayGame game;
+  while (reader.NextGame(&game)) {
+    session.SetParams(game.params);
+    session.Seed(game.seed);
+    session.Start(game.character_width, game.character_height);
+    const Uint64 steps = reader.Play(&session);
+    total_steps += steps;
+    simulated += steps * static_cast<double>(game.params.time_step);
+    games++;
+    if (!game.has_end) {
+      continue;
+    }
+    verified++;
+    const SDL_Rect box = session.GetPhysicsObject().GetBox();
+    if (session.GetScore() != game.score ||
+        session.GetCameraX() != game.camera_x || box.x != game.box.x ||
+        box.y != game.box.y || box.w != game.box.w || box.h != game.box.h) {
+      mismatches++;
+      std::printf("game %d seed %llu: recorded score %d camera %d box "
+                  "(%d, %d), replayed score %d camera %d box (%d, %d)\n",
+                  games, static_cast<unsigned long long>(game.seed),
+                  game.score, game.camera_x, game.box.x, game.box.y,
+                  session.GetScore(), session.GetCameraX(), box.x, box.y);
+    }
+  }
+  const double elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+  std::printf("games:               %d (%d with an end to verify)\n", games,
+              verified);
+  std::printf("replayed steps:      %llu\n",
+              static_cast<unsigned long long>(total_steps));
+  std::printf("wall time:           %.3f s\n", elapsed);
+  std::printf("real-time factor:    %.1fx\n", simulated / elapsed);
+  std::printf("mismatched games:    %d\n", mismatches);
+  return mismatches == 0 ? 0 : 1;
+}
+
+// 每个物体一局内的全部结果，用来比较两种实现
+struct BodyTrace {
+  SDL_Rect box;
+  int camera_x;
+  Uint64 hit_hash;
+};
+
+// 物体的起始速度和镜头位置各不相同，每步的振幅也不同
+void InitBenchBody(int i, float *v_x, float *v_y, int *camera_x) {
+  *v_x = (i % 17) * 10.0f;
+  *v_y = -(i % 23) * 20.0f;
+  *camera_x = (i % 50) * 7;
+}
+
+float GetBenchAmplitude(int i, int step) {
+  return ((i * 31 + step * 7) % 100) / 100.0f;
+}
+
+Uint64 HashHit(Uint64 hash, const HitDetectionResult &r) {
+  return hash * 31 + (r.hit_block_id + 1) * 4 + r.hit_lower_border * 2 +
+         r.hit_upper_border;
+}
+
+// Returns the wall time in seconds
+double RunPhysicsWorld(SimdLevel simd, const BlockRing &blocks,
+                       const SDL_Rect &start_box, int bodies,
+                       const SessionParams &params,
+                       std::vector<BodyTrace> *traces) {
+  PhysicsWorld world(simd);
+  std::vector<int> camera_x(bodies);
+  std::vector<HitDetectionResult> results(bodies);
+  traces->assign(bodies, {});
+  for (int i = 0; i < bodies; i++) {
+    float v_x, v_y;
+    InitBenchBody(i, &v_x, &v_y, &camera_x[i]);
+    world.AddBody(start_box);
+    world.ApplyVelocity(i, v_x, v_y);
+    world.ApplyForce(i, 0, params.gravity);
+    world.SetFriction(i, params.friction_horizontal, params.friction_vertical);
+  }
+  const float impulse_scale = params.time_step * kAmplitudeImpulseRate;
+  const auto begin = std::chrono::steady_clock::now();
+  for (int step = 0; step < kPhysicsBenchSteps; step++) {
+    for (int i = 0; i < bodies; i++) {
+      const float a = GetBenchAmplitude(i, step);
+      world.ApplyVelocity(
+          i, a * params.amplitude_to_horizontal_speed * impulse_scale,
+          -a * params.amplitude_to_vertical_speed * impulse_scale);
+    }
+    world.Update(blocks, camera_x.data(), params.time_step, results.data());
+    for (int i = 0; i < bodies; i++) {
+      camera_x[i] += world.GetDeltaX(i);
+      (*traces)[i].hit_hash = HashHit((*traces)[i].hit_hash, results[i]);
+    }
+  }
+  const double elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+  for (int i = 0; i < bodies; i++) {
+    (*traces)[i].box = world.GetBox(i);
+    (*traces)[i].camera_x = camera_x[i];
+  }
+  return elapsed;
+}
+
+double RunPhysicsObjects(const BlockRing &blocks, const SDL_Rect &start_box,
+                         int bodies, const SessionParams &params,
+                         std::vector<BodyTrace> *traces) {
+  std::vector<PhysicsObject> objects(bodies);
+  std::vector<int> camera_x(bodies);
+  traces->assign(bodies, {});
+  for (int i = 0; i < bodies; i++) {
+    float v_x, v_y;
+    InitBenchBody(i, &v_x, &v_y, &camera_x[i]);
+    objects[i].Init(start_box);
+    objects[i].ApplyVelocity(v_x, v_y);
+    objects[i].ApplyForce(0, params.gravity);
+    objects[i].SetFriction(params.friction_horizontal,
+                           params.friction_vertical);
+  }
+  const float impulse_scale = params.time_step * kAmplitudeImpulseRate;
+  const auto begin = std::chrono::steady_clock::now();
+  for (int step = 0; step < kPhysicsBenchSteps; step++) {
+    for (int i = 0; i < bodies; i++) {
+      const float a = GetBenchAmplitude(i, step);
+      objects[i].ApplyVelocity(
+          a * params.amplitude_to_horizontal_speed * impulse_scale,
+          -a * params.amplitude_to_vertical_speed * impulse_scale);
+      const HitDetectionResult r =
+          objects[i].Update(blocks, camera_x[i], params.time_step);
+      camera_x[i] += objects[i].GetDeltaX();
+      (*traces)[i].hit_hash = HashHit((*traces)[i].hit_hash, r);
+    }
+  }
+  const double elapsed = std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - begin)
+                             .count();
+  for (int i = 0; i < bodies; i++) {
+    (*traces)[i].box = objects[i].GetBox();
+    (*traces)[i].camera_x = camera_x[i];
+  }
+  return elapsed;
+}
+
+// A body that ends a step inside a block stays stuck there, so every step
+// must leave it outside the block and still moving forward.
+int RunCollisionCheck() {
+  BlockRing blocks;
+  blocks.Init(1);
+  blocks.PushBack(kCornerBlock);
+  PhysicsObject object;
+  object.Init(kCornerBox);
+  object.ApplyVelocity(kCornerVelocity, kCornerVelocity);
+  int camera_x = 0;
+  bool passed = true;
+  for (int step = 0; step < kCornerSteps; step++) {
+    object.Update(blocks, camera_x, kCornerTimeStep);
+    camera_x += object.GetDeltaX();
+    SDL_Rect box = object.GetBox();
+    box.x += camera_x;
+    if (object.GetDeltaX() == 0 ||
+        CheckBoxCollision(box, kCornerBlock) == kCollisionBoth) {
+      std::printf("corner collision:    step %d stuck at (%d, %d)\n", step,
+                  box.x, box.y);
+      passed = false;
+      break;
+    }
+  }
+  if (passed) {
+    std::printf("corner collision:    ok\n");
+  }
+  return passed ? 0 : 1;
+}
+
+// 同样的输入分别驱动PhysicsWorld和一组PhysicsObject，比较结果和吞吐量
+int RunPhysicsBenchmark(const HeadlessOptions &options) {
+  const int bodies = options.physics_bench_bodies;
+  GameSession session;
+  session.SetLevelPrefetch(false);
+  session.SetLookAhead(kPhysicsBenchBlocks);
+  session.Seed(options.seed);
+  const BatchConfig defaults;
+  session.Start(defaults.character_width, defaults.character_height);
+  const BlockRing &blocks = session.GetBlocks();
+  const SDL_Rect start_box = session.GetPhysicsObject().GetBox();
+
+  std::vector<BodyTrace> reference, traces;
+  const double object_time = RunPhysicsObjects(blocks, start_box, bodies,
+                                               options.params, &reference);
+  const double body_steps = static_cast<double>(bodies) * kPhysicsBenchSteps;
+  std::printf("bodies:              %d x %d steps\n", bodies,
+              kPhysicsBenchSteps);
+  std::printf("PhysicsObject:       %.3g bodies/s\n", body_steps / object_time);
+
+  bool identical = true;
+  for (SimdLevel simd : {SimdLevel::kScalar, GetSimdLevel()}) {
+    const double time = RunPhysicsWorld(simd, blocks, start_box, bodies,
+                                        options.params, &traces);
+    int mismatches = 0, max_deviation = 0;
+    for (int i = 0; i < bodies; i++) {
+      const int deviation =
+          std::max(std::abs(traces[i].box.y - reference[i].box.y),
+                   std::abs(traces[i].camera_x - reference[i].camera_x));
+      max_deviation = std::max(max_deviation, deviation);
+      if (deviation != 0 || traces[i].hit_hash != reference[i].hit_hash) {
+        mismatches++;
+      }
+    }
+    identical = identical && mismatches == 0;
+    std::printf("PhysicsWorld %-6s  %.3g bodies/s (%.2fx), %d mismatched, "
+                "max deviation %d px\n",
+                simd == SimdLevel::kScalar ? "scalar" : "SIMD",
+                body_steps / time, object_time / time, mismatches,
+                max_deviation);
+  }
+  return identical ? 0 : 1;
+}
+
+bool ParseOptions(int argc, char **argv, HeadlessOptions *options) {
+  for (int i = 1; i < argc; i++) {
+    if (i + 1 < argc && std::strcmp(argv[i], "--episodes") == 0) {
+      options->episodes = std::max(1, std::atoi(argv[++i]));
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--seed") == 0) {
+      options->seed =
+          static_cast<unsigned int>(std::strtoul(argv[++i], nullptr, 10));
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--max-time") == 0) {
+      options->max_episode_time = static_cast<float>(std::atof(argv[++i]));
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--look-ahead") == 0) {
+      options->look_ahead = std::atoi(argv[++i]);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--threads") == 0) {
+      options->threads = std::atoi(argv[++i]);
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--gravity") == 0) {
+      options->params.gravity = static_cast<float>(std::atof(argv[++i]));
+    } else if (i + 1 < argc &&
+               std::strcmp(argv[i], "--vertical-speed") == 0) {
+      options->params.amplitude_to_vertical_speed =
+          static_cast<float>(std::atof(argv[++i]));
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--friction-x") == 0) {
+      options->params.friction_horizontal =
+          static_cast<float>(std::atof(argv[++i]));
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--time-step") == 0) {
+      options->params.time_step =
+          std::max(1e-4f, static_cast<float>(std::atof(argv[++i])));
+    } else if (i + 1 < argc &&
+               std::strcmp(argv[i], "--physics-bench") == 0) {
+      options->physics_bench_bodies = std::max(1, std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "--check-collisions") == 0) {
+      options->check_collisions = true;
+    } else if (std::strcmp(argv[i], "--check-allocations") == 0) {
+      options->check_allocations = true;
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--record") == 0) {
+      options->record_path = argv[++i];
+    } else if (i + 1 < argc && std::strcmp(argv[i], "--replay") == 0) {
+      options->replay_path = argv[++i];
+    } else {
+      std::fprintf(stderr,
+                   "Usage: %s [--episodes N] [--seed S] [--max-time SECONDS] "
+                   "[--look-ahead BLOCKS] [--threads N] [--gravity G] "
+                   "[--vertical-speed V] [--friction-x F] "
+                   "[--time-step SECONDS] [--physics-bench BODIES] "
+                   "[--check-collisions] [--check-allocations] "
+                   "[--record FILE] [--replay FILE]\n",
+                   argv[0]);
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  HeadlessOptions options;
+  if (!ParseOptions(argc, argv, &options)) {
+    return 1;
+  }
+  if (options.physics_bench_bodies > 0) {
+    return RunPhysicsBenchmark(options);
+  }
+  if (options.check_collisions) {
+    return RunCollisionCheck();
+  }
+  if (options.check_allocations) {
+#ifdef HAKUSYU_CHECK_ALLOCATIONS
+    return RunAllocationCheck(options);
+#else
+    std::fprintf(stderr,
+                 "--check-allocations needs -DHAKUSYU_CHECK_ALLOCATIONS=ON\n");
+    return 1;
+#endif
+  }
+  try {
+    if (options.record_path != nullptr) {
+      return RunRecord(options);
+    }
+    if (options.replay_path != nullptr) {
+      return RunReplay(options);
+    }
+  } catch (GameError &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  BatchConfig config;
+  config.episodes = options.episodes;
+  config.seed = options.seed;
+  config.max_episode_time = options.max_episode_time;
+  config.look_ahead = options.look_ahead;
+  config.params = options.params;
+  BatchRunner runner(options.threads);
+  const BatchResult result = runner.Run(
+      config, [] { return std::make_unique<RandomClapPolicy>(); });
+
+  const double elapsed = result.wall_seconds;
+  const long long total_steps = result.total_steps;
+  const double simulated =
+      total_steps * static_cast<double>(options.params.time_step);
+  std::printf("episodes:            %d\n", options.episodes);
+  std::printf("threads:             %d\n", runner.GetThreadCount());
+  std::printf("simulated steps:     %lld\n", total_steps);
+  std::printf("wall time:           %.3f s\n", elapsed);
+  std::printf("simulated frames/s:  %.0f\n", total_steps / elapsed);
+  std::printf("real-time factor:    %.1fx\n", simulated / elapsed);
+  std::printf("mean episode length: %.2f s\n", simulated / options.episodes);
+  std::printf("score mean/min/max:  %.2f / %d / %d\n", result.mean_score,
+              result.min_score, result.max_score);
+  std::printf("score p50/p90/p99:   %d / %d / %d\n",
+              result.GetScorePercentile(0.5f),
+              result.GetScorePercentile(0.9f),
+              result.GetScorePercentile(0.99f));
+  return 0;
+}
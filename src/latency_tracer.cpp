@@ -0,0 +1,186 @@
+#include "latency_tracer.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace {
+
+// Trace里的线程编号
+constexpr int kAudioTrack = 1;
+constexpr int kSimulationTrack = 2;
+constexpr int kRenderTrack = 3;
+
+}  // namespace
+
+LatencyTracer &LatencyTracer::Get() {
+  static LatencyTracer tracer;
+  return tracer;
+}
+
+const char *LatencyTracer::GetSegmentName(LatencySegment segment) {
+  switch (segment) {
+    case LatencySegment::kCaptureToAmplitude:
+      return "capture_to_amplitude";
+    case LatencySegment::kAmplitudeToPhysics:
+      return "amplitude_to_physics";
+    case LatencySegment::kPhysicsToPresent:
+      return "physics_to_present";
+    case LatencySegment::kSoundToPhoton:
+      return "sound_to_photon";
+    default:
+      return "unknown";
+  }
+}
+
+LatencyTracer::LatencyTracer()
+    : microseconds_per_tick_(1e6 / SDL_GetPerformanceFrequency()) {}
+
+void LatencyTracer::AddFrame(const LatencyFrame &frame) {
+  if (frame.capture == 0) {
+    return;
+  }
+  const Uint64 ends[kLatencySegmentCount] = {frame.amplitude, frame.physics,
+                                             frame.present_end,
+                                             frame.present_end};
+  const Uint64 begins[kLatencySegmentCount] = {frame.capture, frame.amplitude,
+                                               frame.physics, frame.capture};
+  for (int s = 0; s < kLatencySegmentCount; s++) {
+    // 不同线程的时钟读数理论上单调，保险起见负值按0算
+    const Uint64 ticks = ends[s] > begins[s] ? ends[s] - begins[s] : 0;
+    const int bucket = static_cast<int>(ticks * microseconds_per_tick_ /
+                                        kHistogramBucketMicroseconds);
+    histograms_[s][std::min(bucket, kHistogramBuckets - 1)]++;
+  }
+  histogram_count_++;
+  if (frame_count_ < kMaxFrames) {
+    frames_[frame_count_++] = frame;
+  }
+}
+
+float LatencyTracer::GetPercentile(LatencySegment segment, float percentile) {
+  if (histogram_count_ == 0) {
+    return 0.0f;
+  }
+  const Uint32 *histogram = histograms_[static_cast<int>(segment)];
+  const Uint64 rank = std::max<Uint64>(
+      1, static_cast<Uint64>(percentile * histogram_count_ + 0.5));
+  Uint64 seen = 0;
+  int b = 0;
+  for (; b < kHistogramBuckets - 1; b++) {
+    seen += histogram[b];
+    if (seen >= rank) {
+      break;
+    }
+  }
+  // 桶的中点
+  return (b + 0.5f) * kHistogramBucketMicroseconds / 1000.0f;
+}
+
+void LatencyTracer::LogSummary() {
+  SDL_Log("Latency over %llu frames (ms):",
+          static_cast<unsigned long long>(histogram_count_));
+  for (int s = 0; s < kLatencySegmentCount; s++) {
+    const LatencySegment segment = static_cast<LatencySegment>(s);
+    SDL_Log("  %-22s p50 %7.2f p90 %7.2f p99 %7.2f", GetSegmentName(segment),
+            GetPercentile(segment, 0.5f), GetPercentile(segment, 0.9f),
+            GetPercentile(segment, 0.99f));
+  }
+}
+
+bool LatencyTracer::WriteCsv(const char *path) {
+  std::FILE *f = std::fopen(path, "w");
+  if (f == nullptr) {
+    return false;
+  }
+  std::fprintf(f, "segment,bucket_begin_us,bucket_end_us,frames\n");
+  for (int s = 0; s < kLatencySegmentCount; s++) {
+    for (int b = 0; b < kHistogramBuckets; b++) {
+      if (histograms_[s][b] == 0) {
+        continue;
+      }
+      std::fprintf(f, "%s,%d,%d,%u\n",
+                   GetSegmentName(static_cast<LatencySegment>(s)),
+                   b * kHistogramBucketMicroseconds,
+                   (b + 1) * kHistogramBucketMicroseconds, histograms_[s][b]);
+    }
+  }
+  std::fclose(f);
+  return true;
+}
+
+bool LatencyTracer::WriteTrace(const char *path) {
+  std::FILE *f = std::fopen(path, "w");
+  if (f == nullptr) {
+    return false;
+  }
+  const Uint64 base = frame_count_ > 0 ? frames_[0].capture : 0;
+  auto us = [&](Uint64 ticks) {
+    return ticks > base ? (ticks - base) * microseconds_per_tick_ : 0.0;
+  };
+  std::fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+  // 逗号写在每个事件前面，最后一个事件后面不留多余的逗号
+  bool first_event = true;
+  auto begin_event = [&]() {
+    if (!first_event) {
+      std::fputs(",\n", f);
+    }
+    first_event = false;
+  };
+  const struct {
+    int track;
+    const char *name;
+  } tracks[] = {{kAudioTrack, "audio"},
+                {kSimulationTrack, "simulation"},
+                {kRenderTrack, "render"}};
+  for (const auto &track : tracks) {
+    begin_event();
+    std::fprintf(f,
+                 "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+                 track.track, track.name);
+  }
+  // 同一个音频块和同一次物理步进会被几帧共用，只输出一次
+  Uint64 last_capture = 0, last_physics = 0;
+  for (int i = 0; i < frame_count_; i++) {
+    const LatencyFrame &frame = frames_[i];
+    if (frame.capture != last_capture) {
+      last_capture = frame.capture;
+      begin_event();
+      std::fprintf(f,
+                   "{\"name\":\"capture\",\"ph\":\"i\",\"s\":\"t\","
+                   "\"pid\":1,\"tid\":%d,\"ts\":%.1f}",
+                   kAudioTrack, us(frame.capture));
+    }
+    if (frame.physics != last_physics) {
+      last_physics = frame.physics;
+      begin_event();
+      std::fprintf(f,
+                   "{\"name\":\"amplitude_physics\",\"ph\":\"X\",\"pid\":1,"
+                   "\"tid\":%d,\"ts\":%.1f,\"dur\":%.1f}",
+                   kSimulationTrack, us(frame.amplitude),
+                   us(frame.physics) - us(frame.amplitude));
+    }
+    begin_event();
+    std::fprintf(f,
+                 "{\"name\":\"present\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,"
+                 "\"ts\":%.1f,\"dur\":%.1f}",
+                 kRenderTrack, us(frame.present_begin),
+                 us(frame.present_end) - us(frame.present_begin));
+    // 异步事件可以互相重叠，每帧的整条延迟一个
+    begin_event();
+    std::fprintf(f,
+                 "{\"name\":\"sound_to_photon\",\"cat\":\"latency\","
+                 "\"ph\":\"b\",\"id\":%d,\"pid\":1,\"tid\":%d,\"ts\":%.1f}",
+                 i, kRenderTrack, us(frame.capture));
+    begin_event();
+    std::fprintf(f,
+                 "{\"name\":\"sound_to_photon\",\"cat\":\"latency\","
+                 "\"ph\":\"e\",\"id\":%d,\"pid\":1,\"tid\":%d,\"ts\":%.1f,"
+                 "\"args\":{\"ms\":%.3f}}",
+                 i, kRenderTrack, us(frame.present_end),
+                 (us(frame.present_end) - us(frame.capture)) / 1000.0);
+  }
+  std::fprintf(f, "\n]}\n");
+  std::fclose(f);
+  return true;
+}
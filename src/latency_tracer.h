@@ -0,0 +1,61 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+// 声音到画面的延迟：每一帧记录它用到的最新音频块经过各阶段的时刻
+// Timestamps are SDL_GetPerformanceCounter ticks. Only the render thread
+// calls AddFrame, the simulation thread passes its timestamps along in the
+// WorldSnapshot.
+
+enum class LatencySegment {
+  // Audio callback to the simulation reading the loudness
+  kCaptureToAmplitude,
+  // Reading the loudness to the end of the physics steps that used it
+  kAmplitudeToPhysics,
+  // End of the physics steps to SDL_RenderPresent returning
+  kPhysicsToPresent,
+  // The whole path, what the player feels
+  kSoundToPhoton,
+  kCount,
+};
+
+constexpr int kLatencySegmentCount = static_cast<int>(LatencySegment::kCount);
+
+struct LatencyFrame {
+  // Callback of the newest audio chunk the frame acted on
+  Uint64 capture = 0;
+  Uint64 amplitude = 0;
+  Uint64 physics = 0;
+  Uint64 present_begin = 0;
+  Uint64 present_end = 0;
+};
+
+class LatencyTracer {
+ public:
+  // The trace keeps the first kMaxFrames frames, the histograms all of them
+  static constexpr int kMaxFrames = 1 << 16;
+  static constexpr int kHistogramBucketMicroseconds = 250;
+  static constexpr int kHistogramBuckets = 1000;
+
+  static LatencyTracer &Get();
+  static const char *GetSegmentName(LatencySegment segment);
+
+  // Render thread. Frames before the first audio chunk are ignored.
+  void AddFrame(const LatencyFrame &frame);
+  // Over all recorded frames, in milliseconds
+  float GetPercentile(LatencySegment segment, float percentile);
+  // p50/p90/p99 of every segment through SDL_Log
+  void LogSummary();
+  bool WriteCsv(const char *path);
+  // Chrome trace event format, opens in chrome://tracing or Perfetto
+  bool WriteTrace(const char *path);
+
+ private:
+  LatencyTracer();
+
+  double microseconds_per_tick_;
+  LatencyFrame frames_[kMaxFrames];
+  int frame_count_ = 0;
+  Uint64 histogram_count_ = 0;
+  Uint32 histograms_[kLatencySegmentCount][kHistogramBuckets] = {};
+};
@@ -0,0 +1,110 @@
+#include "level_generator.h"
+
+#include <algorithm>
+
+#include "config.h"
+#include "pcg32.h"
+
+LevelGenerator::~LevelGenerator() { Stop(); }
+
+void LevelGenerator::SetPrefetch(bool enabled) { prefetch_ = enabled; }
+
+void LevelGenerator::Start(Uint64 seed) {
+  Stop();
+  seed_ = seed;
+  for (Slot &slot : slots_) {
+    slot.index.store(kNoChunk, std::memory_order_relaxed);
+  }
+  GenerateChunk(seed_, 0, &current_);
+  current_index_ = 0;
+  current_position_ = 0;
+  misses_ = 0;
+  consumed_.store(1, std::memory_order_relaxed);
+  if (prefetch_) {
+    running_.store(true, std::memory_order_relaxed);
+    worker_ = std::thread(&LevelGenerator::WorkerMain, this);
+  }
+}
+
+void LevelGenerator::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    running_.store(false, std::memory_order_relaxed);
+  }
+  wake_.notify_one();
+  if (worker_.joinable()) {
+    worker_.join();
+  }
+}
+
+void LevelGenerator::NextBlock(int *width, int *height) {
+  if (current_position_ == kLevelChunkBlocks) {
+    LoadChunk(current_index_ + 1);
+  }
+  *width = current_.width[current_position_];
+  *height = current_.height[current_position_];
+  current_position_++;
+}
+
+Uint64 LevelGenerator::GetMissCount() const { return misses_; }
+
+void LevelGenerator::GenerateChunk(Uint64 seed, Uint64 index,
+                                   LevelChunk *chunk) {
+  const int min_height = static_cast<int>(0.2 * kWindowHeight);
+  const int max_height = static_cast<int>(0.6 * kWindowHeight);
+  const int block_width = static_cast<int>(kWindowWidth / division);
+  const int min_width = static_cast<int>(0.3 * block_width);
+  const int max_width = static_cast<int>(0.6 * block_width);
+
+  Pcg32 rng(seed, index);
+  for (int i = 0; i < kLevelChunkBlocks; i++) {
+    chunk->width[i] = rng.NextInRange(min_width, max_width);
+    chunk->height[i] = rng.NextInRange(min_height, max_height);
+  }
+}
+
+void LevelGenerator::LoadChunk(Uint64 index) {
+  if (!worker_.joinable()) {
+    GenerateChunk(seed_, index, &current_);
+    current_index_ = index;
+    current_position_ = 0;
+    return;
+  }
+  const Slot &slot = slots_[index % kLevelPrefetchChunks];
+  if (slot.index.load(std::memory_order_acquire) == index) {
+    current_ = slot.chunk;
+  } else {
+    GenerateChunk(seed_, index, &current_);
+    misses_++;
+  }
+  current_index_ = index;
+  current_position_ = 0;
+  {
+    // 拷贝完成后才释放槽位，工作线程不会覆盖正在读的数据
+    std::lock_guard<std::mutex> lock(mutex_);
+    consumed_.store(index + 1, std::memory_order_release);
+  }
+  wake_.notify_one();
+}
+
+void LevelGenerator::WorkerMain() {
+  Uint64 next = 1;
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (running_.load(std::memory_order_relaxed)) {
+    const Uint64 limit =
+        consumed_.load(std::memory_order_acquire) + kLevelPrefetchChunks;
+    if (next < limit) {
+      // 调用方可能已经自己生成并跳过了一些块
+      next = std::max(next, consumed_.load(std::memory_order_acquire));
+      lock.unlock();
+      for (; next < limit; next++) {
+        Slot &slot = slots_[next % kLevelPrefetchChunks];
+        GenerateChunk(seed_, next, &slot.chunk);
+        slot.index.store(next, std::memory_order_release);
+      }
+      lock.lock();
+      continue;
+    }
+    wake_.wait(lock);
+  }
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+constexpr int kLevelChunkBlocks = 64;
+constexpr int kLevelPrefetchChunks = 4;
+
+// Sizes only, positions follow from the previous block when they are placed
+struct LevelChunk {
+  int width[kLevelChunkBlocks];
+  int height[kLevelChunkBlocks];
+};
+
+// 按块生成关卡，后台线程提前生成后面的几块
+// Chunk n only depends on the seed and n, so a seed always gives the same
+// level no matter whether the worker or the caller generated a chunk.
+class LevelGenerator {
+ public:
+  LevelGenerator() = default;
+  LevelGenerator(const LevelGenerator &) = delete;
+  LevelGenerator &operator=(const LevelGenerator &) = delete;
+  ~LevelGenerator();
+
+  // Without prefetching every chunk is generated by the caller when it is
+  // reached, e.g. when many generators already run on all cores. Takes
+  // effect on the next Start.
+  void SetPrefetch(bool enabled);
+  // Generates the first chunk in place and starts prefetching the rest
+  void Start(Uint64 seed);
+  void Stop();
+  // Size of the next block. Never waits for the worker, if it falls behind
+  // the chunk is generated here instead.
+  void NextBlock(int *width, int *height);
+  // Chunks the caller had to generate itself because the worker was late
+  Uint64 GetMissCount() const;
+
+  static void GenerateChunk(Uint64 seed, Uint64 index, LevelChunk *chunk);
+
+ private:
+  static constexpr Uint64 kNoChunk = UINT64_MAX;
+
+  struct Slot {
+    std::atomic<Uint64> index{kNoChunk};
+    LevelChunk chunk;
+  };
+
+  void LoadChunk(Uint64 index);
+  void WorkerMain();
+
+  Uint64 seed_ = 0;
+  LevelChunk current_;
+  Uint64 current_index_ = 0;
+  int current_position_ = 0;
+  Uint64 misses_ = 0;
+  bool prefetch_ = true;
+  std::array<Slot, kLevelPrefetchChunks> slots_;
+  // Chunks before this one have been taken by the caller, the worker may
+  // fill slots up to kLevelPrefetchChunks ahead of it
+  std::atomic<Uint64> consumed_{0};
+  std::atomic<bool> running_{false};
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::thread worker_;
+};
@@ -0,0 +1,122 @@
+#include "loudness_meter.h"
+
+#include <algorithm>
+#include <cmath>
+
+void LoudnessMeter::Init(int sample_rate, int history_milliseconds) {
+  sample_rate_ = sample_rate;
+
+  const Uint64 history_blocks =
+      static_cast<Uint64>(sample_rate) * history_milliseconds / 1000 /
+          kBlockFrames +
+      1;
+  size_t capacity = 2;
+  while (capacity < history_blocks) {
+    capacity <<= 1;
+  }
+  mask_ = capacity - 1;
+  prefix_sums_.reset(new std::atomic<Uint64>[capacity]);
+  for (size_t i = 0; i < capacity; i++) {
+    prefix_sums_[i].store(0, std::memory_order_relaxed);
+  }
+  total_sum_ = 0;
+  pending_samples_ = 0;
+  block_count_.store(0, std::memory_order_release);
+}
+
+void LoudnessMeter::SetWindow(int window_milliseconds) {
+  const int blocks = static_cast<int>(
+      static_cast<Sint64>(sample_rate_) * window_milliseconds / 1000 /
+      kBlockFrames);
+  // 留一半的历史给写入端，保证读取时不会被覆盖
+  window_blocks_.store(
+      std::clamp(blocks, 1, static_cast<int>((mask_ + 1) / 2)),
+      std::memory_order_relaxed);
+}
+
+void LoudnessMeter::Process(const float *samples, size_t sample_count) {
+  Uint64 blocks = block_count_.load(std::memory_order_relaxed);
+  Uint64 sum = total_sum_;
+  size_t i = 0;
+  while (i < sample_count) {
+    const size_t n =
+        std::min(sample_count - i,
+                 static_cast<size_t>(kBlockFrames - pending_samples_));
+    // 量化回S16单位的整数再累加，前缀和保持精确，响度的单位也不变
+    Uint32 block_sum = 0;
+    for (size_t j = i; j < i + n; j++) {
+      block_sum += static_cast<Uint32>(std::fabs(samples[j]) * 32768.0f + 0.5f);
+    }
+    sum += block_sum;
+    i += n;
+    pending_samples_ += static_cast<int>(n);
+    if (pending_samples_ == kBlockFrames) {
+      pending_samples_ = 0;
+      blocks++;
+      prefix_sums_[blocks & mask_].store(sum, std::memory_order_relaxed);
+      block_count_.store(blocks, std::memory_order_release);
+    }
+  }
+  total_sum_ = sum;
+}
+
+float LoudnessMeter::GetLoudness() const {
+  const Uint64 window = window_blocks_.load(std::memory_order_relaxed);
+  while (true) {
+    const Uint64 blocks = block_count_.load(std::memory_order_acquire);
+    if (blocks < window) {
+      return 0.0f;
+    }
+    const Uint64 newest =
+        prefix_sums_[blocks & mask_].load(std::memory_order_relaxed);
+    const Uint64 oldest =
+        prefix_sums_[(blocks - window) & mask_].load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // 读取期间写入端绕了一圈的话重新读
+    if (block_count_.load(std::memory_order_relaxed) - (blocks - window) <=
+        mask_) {
+      return static_cast<float>(newest - oldest) /
+             static_cast<float>(window * kBlockFrames);
+    }
+  }
+}
+
+bool LoudnessMeter::IsReady() const {
+  return block_count_.load(std::memory_order_acquire) >=
+         static_cast<Uint64>(window_blocks_.load(std::memory_order_relaxed));
+}
+
+Uint64 LoudnessMeter::GetCursor() const {
+  return block_count_.load(std::memory_order_acquire);
+}
+
+int LoudnessMeter::ReadWindows(Uint64 *cursor, float *values,
+                               int max_count) const {
+  const Uint64 window = window_blocks_.load(std::memory_order_relaxed);
+  const Uint64 history = (mask_ + 1) / 2;
+  const Uint64 blocks = block_count_.load(std::memory_order_acquire);
+  if (blocks > *cursor + history) {
+    *cursor = blocks - history;
+  }
+  const Uint64 begin = *cursor;
+  int count = 0;
+  Uint64 position = begin;
+  while (count < max_count && position + window <= blocks) {
+    const Uint64 end = position + window;
+    const Uint64 newest =
+        prefix_sums_[end & mask_].load(std::memory_order_relaxed);
+    const Uint64 oldest =
+        prefix_sums_[position & mask_].load(std::memory_order_relaxed);
+    values[count++] = static_cast<float>(newest - oldest) /
+                      static_cast<float>(window * kBlockFrames);
+    position += window;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (block_count_.load(std::memory_order_relaxed) - begin > mask_) {
+    // 读取期间被覆盖了，丢掉这一批
+    *cursor = block_count_.load(std::memory_order_acquire);
+    return 0;
+  }
+  *cursor = position;
+  return count;
+}
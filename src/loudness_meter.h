@@ -0,0 +1,44 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+#include <memory>
+
+// 在音频回调里增量维护的滑动窗口响度
+// The audio thread appends a prefix sum of absolute sample values every
+// kBlockFrames frames, so the game thread gets the mean absolute amplitude of
+// the newest window with two loads instead of walking the buffer.
+class LoudnessMeter {
+ public:
+  static constexpr int kBlockFrames = 8;
+
+  // Works on the mono analysis stream. history_milliseconds bounds the
+  // longest window that can be queried.
+  void Init(int sample_rate, int history_milliseconds);
+  // Can be called from the game thread at any time
+  void SetWindow(int window_milliseconds);
+  // Audio thread only, samples are normalized to [-1, 1]
+  void Process(const float *samples, size_t sample_count);
+  // Mean absolute amplitude of the newest window in S16 units, O(1).
+  // Returns 0 until a full window has been captured.
+  float GetLoudness() const;
+  bool IsReady() const;
+  // Stream position for ReadWindows, in blocks
+  Uint64 GetCursor() const;
+  // Mean absolute amplitude of consecutive, non-overlapping windows that were
+  // completed after *cursor, the same statistic as GetLoudness. Advances
+  // *cursor, skipping data that is about to be overwritten. Returns the number
+  // of values written.
+  int ReadWindows(Uint64 *cursor, float *values, int max_count) const;
+
+ private:
+  int sample_rate_ = 44100;
+  size_t mask_ = 0;
+  std::unique_ptr<std::atomic<Uint64>[]> prefix_sums_;
+  std::atomic<Uint64> block_count_{0};
+  std::atomic<int> window_blocks_{1};
+  // Only touched by the audio thread
+  Uint64 total_sum_ = 0;
+  int pending_samples_ = 0;
+};
@@ -1,14 +1,65 @@
 
 #include <Windows.h>
 
+#include <cstdlib>
+#include <cstring>
+
 #include "game.h"
 
 void ErrorMessageBox(const char *msg);
 
+// --wav <file> or --synthetic <silence|noise|claps> replaces the microphone,
+// --speed <x> plays them x times faster than real time (0: unthrottled)
+std::unique_ptr<AudioSource> CreateAudioSource(int argc, char **argv) {
+  const char *wav_path = nullptr;
+  const char *synthetic = nullptr;
+  float speed = 1.0f;
+  for (int i = 1; i + 1 < argc; i++) {
+    if (std::strcmp(argv[i], "--wav") == 0) {
+      wav_path = argv[++i];
+    } else if (std::strcmp(argv[i], "--synthetic") == 0) {
+      synthetic = argv[++i];
+    } else if (std::strcmp(argv[i], "--speed") == 0) {
+      speed = static_cast<float>(std::atof(argv[++i]));
+    }
+  }
+  if (wav_path != nullptr) {
+    return std::make_unique<WavFileSource>(wav_path, speed, true);
+  }
+  if (synthetic != nullptr) {
+    SyntheticSignal signal;
+    if (std::strcmp(synthetic, "silence") == 0) {
+      signal = SyntheticSignal::kSilence;
+    } else if (std::strcmp(synthetic, "noise") == 0) {
+      signal = SyntheticSignal::kNoise;
+    } else if (std::strcmp(synthetic, "claps") == 0) {
+      signal = SyntheticSignal::kClaps;
+    } else {
+      throw GameError("Unknown synthetic signal");
+    }
+    return std::make_unique<SyntheticSource>(signal, speed, 1);
+  }
+  return nullptr;
+}
+
 int main(int argc, char **argv) {
   try {
     Game::SetupEnvironment();
     Game game;
+    game.SetAudioSource(CreateAudioSource(argc, argv));
+    // --seed <n> replays the same level every game, --record <file> appends
+    // every game to a replay log, --clap-band <low> <high> listens to that
+    // band in Hz only
+    for (int i = 1; i + 1 < argc; i++) {
+      if (std::strcmp(argv[i], "--seed") == 0) {
+        game.SetLevelSeed(std::strtoull(argv[i + 1], nullptr, 10));
+      } else if (std::strcmp(argv[i], "--record") == 0) {
+        game.SetReplayLog(argv[i + 1]);
+      } else if (i + 2 < argc && std::strcmp(argv[i], "--clap-band") == 0) {
+        game.SetClapBand(static_cast<float>(std::atof(argv[i + 1])),
+                         static_cast<float>(std::atof(argv[i + 2])));
+      }
+    }
     game.Init();
     game.Main();
     game.Exit();
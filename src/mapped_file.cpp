@@ -0,0 +1,94 @@
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "game_error.h"
+
+MappedFile::~MappedFile() { Close(); }
+
+#ifdef _WIN32
+
+void MappedFile::Open(const char *path) {
+  Close();
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE) {
+    throw GameError("Cannot open file");
+  }
+  LARGE_INTEGER size;
+  if (!GetFileSizeEx(file, &size) || size.QuadPart == 0) {
+    CloseHandle(file);
+    throw GameError("Cannot map an empty file");
+  }
+  HANDLE mapping =
+      CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (mapping == nullptr) {
+    CloseHandle(file);
+    throw GameError("Cannot map file");
+  }
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  if (data == nullptr) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    throw GameError("Cannot map file");
+  }
+  file_ = file;
+  mapping_ = mapping;
+  data_ = static_cast<const unsigned char *>(data);
+  size_ = static_cast<size_t>(size.QuadPart);
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    UnmapViewOfFile(data_);
+    CloseHandle(mapping_);
+    CloseHandle(file_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#else
+
+void MappedFile::Open(const char *path) {
+  Close();
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    throw GameError("Cannot open file");
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size == 0) {
+    close(fd);
+    throw GameError("Cannot map an empty file");
+  }
+  void *data = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ,
+                    MAP_PRIVATE, fd, 0);
+  // 映射建立后文件描述符就不需要了
+  close(fd);
+  if (data == MAP_FAILED) {
+    throw GameError("Cannot map file");
+  }
+  data_ = static_cast<const unsigned char *>(data);
+  size_ = static_cast<size_t>(st.st_size);
+}
+
+void MappedFile::Close() {
+  if (data_ != nullptr) {
+    munmap(const_cast<unsigned char *>(data_), size_);
+  }
+  data_ = nullptr;
+  size_ = 0;
+}
+
+#endif
+
+const unsigned char *MappedFile::GetData() const { return data_; }
+
+size_t MappedFile::GetSize() const { return size_; }
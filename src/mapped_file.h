@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+
+// 只读的内存映射文件
+class MappedFile {
+ public:
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile();
+
+  // Throws GameError if the file cannot be opened or mapped
+  void Open(const char *path);
+  void Close();
+  const unsigned char *GetData() const;
+  size_t GetSize() const;
+
+ private:
+  const unsigned char *data_ = nullptr;
+  size_t size_ = 0;
+#ifdef _WIN32
+  void *file_ = nullptr;
+  void *mapping_ = nullptr;
+#endif
+};
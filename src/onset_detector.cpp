@@ -0,0 +1,105 @@
+#include "onset_detector.h"
+
+#include <algorithm>
+#include <cmath>
+
+constexpr float kOnsetThresholdDb = 12.0f;
+// 绝对下限，避免在安静的房间里把细小的噪声当成拍手
+constexpr float kOnsetMinimumDb = 40.0f;
+constexpr float kBackgroundTimeConstant = 0.25f;
+constexpr float kRefractoryTime = 0.08f;
+constexpr float kCallbackPeriodSmoothing = 0.1f;
+
+void OnsetDetector::Init(int sample_rate, int hop_frames, bool level_input) {
+  sample_rate_ = sample_rate;
+  hop_frames_ = std::max(hop_frames, 16);
+  level_input_ = level_input;
+  refractory_hops_ = static_cast<int>(
+      std::ceil(kRefractoryTime * sample_rate_ / hop_frames_));
+  ticks_per_frame_ =
+      static_cast<double>(SDL_GetPerformanceFrequency()) / sample_rate_;
+  last_callback_timestamp_ = 0;
+  hop_position_ = 0;
+  previous_mono_ = 0.0f;
+  hop_energy_ = 0;
+  hop_abs_sum_ = 0;
+  has_background_ = false;
+  // 先让背景能量稳定下来再开始检测
+  hops_until_armed_ = static_cast<int>(kBackgroundTimeConstant * sample_rate_ /
+                                       hop_frames_);
+}
+
+int OnsetDetector::Process(const float *samples, size_t sample_count,
+                           Uint64 callback_timestamp) {
+  int onsets = 0;
+  if (last_callback_timestamp_ != 0) {
+    const float period =
+        static_cast<float>(callback_timestamp - last_callback_timestamp_) /
+        SDL_GetPerformanceFrequency();
+    float smoothed = callback_period_.load(std::memory_order_relaxed);
+    smoothed = smoothed == 0.0f
+                   ? period
+                   : smoothed + (period - smoothed) * kCallbackPeriodSmoothing;
+    callback_period_.store(smoothed, std::memory_order_relaxed);
+  }
+  last_callback_timestamp_ = callback_timestamp;
+
+  const size_t frames = sample_count;
+  for (size_t f = 0; f < frames; f++) {
+    // 阈值和强度都沿用S16单位
+    const float x = samples[f] * 32768.0f;
+    const float d = level_input_ ? x : x - previous_mono_;
+    previous_mono_ = x;
+    hop_energy_ += d * d;
+    hop_abs_sum_ += std::fabs(x);
+
+    if (++hop_position_ == hop_frames_) {
+      const Uint64 behind =
+          static_cast<Uint64>((frames - f - 1) * ticks_per_frame_);
+      if (FinishHop(callback_timestamp - behind)) {
+        onsets++;
+      }
+    }
+  }
+  return onsets;
+}
+
+bool OnsetDetector::FinishHop(Uint64 hop_timestamp) {
+  const float energy = static_cast<float>(hop_energy_ / hop_frames_);
+  const float strength = static_cast<float>(hop_abs_sum_ / hop_frames_);
+  hop_position_ = 0;
+  hop_energy_ = 0;
+  hop_abs_sum_ = 0;
+
+  const float db = 10.0f * std::log10(energy + 1.0f);
+  if (!has_background_) {
+    background_db_ = db;
+    has_background_ = true;
+  }
+  const float flux = db - background_db_;
+  bool onset = false;
+  if (hops_until_armed_ > 0) {
+    hops_until_armed_--;
+  } else if (flux > kOnsetThresholdDb && db > kOnsetMinimumDb) {
+    onset = events_.Push({hop_timestamp, strength,
+                          callback_period_.load(std::memory_order_relaxed)});
+    hops_until_armed_ = refractory_hops_;
+  }
+
+  // 背景能量用一阶低通跟踪，向上的跳变不计入以免拍手抬高背景
+  const float alpha =
+      1.0f - std::exp(-static_cast<float>(hop_frames_) /
+                      (kBackgroundTimeConstant * sample_rate_));
+  background_db_ += (std::min(db, background_db_ + kOnsetThresholdDb * 0.5f) -
+                     background_db_) *
+                    alpha;
+  return onset;
+}
+
+bool OnsetDetector::PollEvent(OnsetEvent *event) { return events_.Pop(event); }
+
+void OnsetDetector::DropEvents() { events_.Clear(); }
+
+float OnsetDetector::GetCallbackPeriod() const {
+  return callback_period_.load(std::memory_order_relaxed);
+}
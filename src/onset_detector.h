@@ -0,0 +1,62 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+
+#include "spsc_queue.h"
+
+struct OnsetEvent {
+  // SDL_GetPerformanceCounter() time of the hop that triggered the onset,
+  // corrected for where the hop ended inside the callback buffer
+  Uint64 timestamp;
+  // Mean absolute amplitude of that hop, in S16 units, the scale of
+  // LoudnessMeter fed the same input
+  float strength;
+  // Measured seconds between two audio callbacks
+  float callback_period;
+};
+
+// 基于能量的拍手起音检测，在音频线程上运行
+// Every hop of a few milliseconds the energy of the first difference of the
+// mono signal (a cheap high-frequency emphasis, claps are broadband while
+// voices and hum are not) is compared with a slowly adapting background level.
+class OnsetDetector {
+ public:
+  // Works on the mono analysis stream. With level_input the samples are a
+  // level that already favors claps, such as BandAnalyzer's clap band, and
+  // are used as they are instead of differenced. The strength is then the
+  // mean level, the statistic LoudnessMeter takes of the same input.
+  void Init(int sample_rate, int hop_frames, bool level_input = false);
+  // Audio thread only, samples are normalized to [-1, 1]. callback_timestamp
+  // is the performance counter value when the callback started, i.e. when the
+  // last frame was captured. Returns the number of onsets queued by this call.
+  int Process(const float *samples, size_t sample_count,
+              Uint64 callback_timestamp);
+  // Game thread only
+  bool PollEvent(OnsetEvent *event);
+  void DropEvents();
+  float GetCallbackPeriod() const;
+
+ private:
+  // Returns true if an onset was queued
+  bool FinishHop(Uint64 hop_timestamp);
+
+  SpscQueue<OnsetEvent, 64> events_;
+  std::atomic<float> callback_period_{0.0f};
+
+  // Only touched by the audio thread
+  int sample_rate_ = 44100;
+  int hop_frames_ = 128;
+  bool level_input_ = false;
+  int refractory_hops_ = 0;
+  double ticks_per_frame_ = 0;
+  Uint64 last_callback_timestamp_ = 0;
+  int hop_position_ = 0;
+  float previous_mono_ = 0.0f;
+  double hop_energy_ = 0;
+  double hop_abs_sum_ = 0;
+  float background_db_ = 0.0f;
+  bool has_background_ = false;
+  int hops_until_armed_ = 0;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+// PCG32随机数发生器，比mt19937小而快，并且在任何平台、任何标准库上序列都相同
+// Different streams of the same seed are independent, so chunk n of a level
+// can be generated on its own with stream n.
+class Pcg32 {
+ public:
+  Pcg32(Uint64 seed, Uint64 stream) : increment_((stream << 1) | 1) {
+    Next();
+    state_ += seed;
+    Next();
+  }
+
+  Uint32 Next() {
+    const Uint64 old = state_;
+    state_ = old * 6364136223846793005ULL + increment_;
+    const Uint32 xorshifted =
+        static_cast<Uint32>(((old >> 18) ^ old) >> 27);
+    const Uint32 rotation = static_cast<Uint32>(old >> 59);
+    return (xorshifted >> rotation) | (xorshifted << ((32 - rotation) & 31));
+  }
+
+  // Integer in [low, high]. Multiply-shift instead of a modulo, the bias is
+  // below (high - low + 1) / 2^32 which is irrelevant for level layout.
+  int NextInRange(int low, int high) {
+    const Uint64 range = static_cast<Uint64>(high - low) + 1;
+    return low + static_cast<int>((static_cast<Uint64>(Next()) * range) >> 32);
+  }
+
+ private:
+  Uint64 state_ = 0;
+  Uint64 increment_;
+};
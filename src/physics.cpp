@@ -0,0 +1,162 @@
+#include "physics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "config.h"
+
+namespace {
+
+// 扫掠检测：box沿一个轴移动delta时最先碰到的方块
+// Blocks are sorted by x and do not overlap, so the candidates are a short
+// run found by binary search over the swept range. Returns the index of the
+// block that is touched first or -1, and how far the box can move before
+// touching it in *travel, 0 if the box already overlaps it.
+int SweepBlocks(const BlockRing &blocks, const SDL_Rect &box, int delta_x,
+                int delta_y, int *travel) {
+  const SDL_Rect swept = {std::min(box.x, box.x + delta_x),
+                          std::min(box.y, box.y + delta_y),
+                          box.w + std::abs(delta_x), box.h + std::abs(delta_y)};
+  int first = -1;
+  for (size_t i = blocks.FindFirstRightOf(swept.x);
+       i < blocks.GetSize() && blocks.GetLeft(i) < swept.x + swept.w; i++) {
+    const SDL_Rect block = blocks.Get(i);
+    if (CheckBoxCollision(swept, block) != kCollisionBoth) {
+      continue;
+    }
+    // 沿运动方向到方块的距离，已经重叠时为负
+    int gap = 0;
+    if (delta_x > 0) {
+      gap = block.x - (box.x + box.w);
+    } else if (delta_x < 0) {
+      gap = box.x - (block.x + block.w);
+    } else if (delta_y > 0) {
+      gap = block.y - (box.y + box.h);
+    } else if (delta_y < 0) {
+      gap = box.y - (block.y + block.h);
+    }
+    gap = std::max(gap, 0);
+    if (first == -1 || gap < *travel) {
+      first = static_cast<int>(i);
+      *travel = gap;
+    }
+  }
+  return first;
+}
+
+}  // namespace
+
+int ResolveBlockCollisions(const BlockRing &blocks, int camera_x,
+                           const SDL_Rect &box, float x_f, float y_f,
+                           StepMotion *motion) {
+  int hit_block_id = -1;
+  int travel = 0;
+  {
+    const SDL_Rect start = {box.x + camera_x, box.y, box.w, box.h};
+    const int delta = motion->x - box.x;
+    int i = SweepBlocks(blocks, start, delta, 0, &travel);
+    if (i != -1) {
+      hit_block_id = i;
+      // 停在接触的位置，一开始就重叠时退回原位
+      motion->x = box.x + (delta < 0 ? -travel : travel);
+      motion->x_f = travel == 0 ? x_f : static_cast<float>(motion->x);
+      motion->v_x = 0;
+    }
+  }
+
+  {
+    // 从已经确定的横坐标开始，斜着撞到方块角上时才不会停在方块里
+    const SDL_Rect start = {motion->x + camera_x, box.y, box.w, box.h};
+    const int delta = motion->y - box.y;
+    int i = SweepBlocks(blocks, start, 0, delta, &travel);
+    if (i != -1) {
+      hit_block_id = i;
+      motion->y = box.y + (delta < 0 ? -travel : travel);
+      motion->y_f = travel == 0 ? y_f : static_cast<float>(motion->y);
+      motion->v_y = 0;
+    }
+  }
+  return hit_block_id;
+}
+
+void PhysicsObject::Init(const SDL_Rect &box) {
+  ResetAllVariables();
+  box_ = box;
+  x_ = static_cast<float>(box.x);
+  y_ = static_cast<float>(box.y);
+  previous_y_ = y_;
+}
+
+void PhysicsObject::ApplyForce(float f_x, float f_y) {
+  f_x_ += f_x;
+  f_y_ += f_y;
+}
+
+void PhysicsObject::ApplyVelocity(float v_x, float v_y) {
+  v_x_ += v_x;
+  v_y_ += v_y;
+}
+
+void PhysicsObject::SetFriction(float friction_x, float friction_y) {
+  friction_x_ = friction_x;
+  friction_y_ = friction_y;
+}
+
+HitDetectionResult PhysicsObject::Update(const BlockRing &blocks, int camera_x,
+                                         float dt) {
+  HitDetectionResult hit_detection_result;
+
+  StepMotion motion;
+  motion.v_x = v_x_ + (f_x_ - Sign(v_x_) * friction_x_ * v_x_ * v_x_) * dt;
+  motion.v_y = v_y_ + (f_y_ - Sign(v_y_) * friction_y_ * v_y_ * v_y_) * dt;
+
+  // 位置用浮点数保存，小步长时不足一个像素的位移也不会丢失
+  motion.x_f = x_ + (motion.v_x + v_x_) * 0.5f * dt;
+  motion.y_f = y_ + (motion.v_y + v_y_) * 0.5f * dt;
+  motion.x = static_cast<int>(std::floor(motion.x_f));
+  motion.y = static_cast<int>(std::floor(motion.y_f));
+
+  hit_detection_result.hit_block_id =
+      ResolveBlockCollisions(blocks, camera_x, box_, x_, y_, &motion);
+
+  delta_x_ = motion.x - box_.x;
+  delta_y_ = motion.y - box_.y;
+  // box_.x = new_x;
+  // 横向位移交给ShiftBlocks，这里只保留不足一像素的部分
+  x_ = motion.x_f - delta_x_;
+  previous_y_ = y_;
+  y_ = motion.y_f;
+  box_.y = motion.y;
+  v_x_ = motion.v_x;
+  v_y_ = motion.v_y;
+
+  if (box_.y >= kWindowHeight) {
+    hit_detection_result.hit_lower_border = true;
+    ;
+  }
+  if (box_.y <= 0) {
+    hit_detection_result.hit_upper_border = true;
+  }
+
+  return hit_detection_result;
+}
+
+int PhysicsObject::GetDeltaX() { return delta_x_; }
+
+int PhysicsObject::GetDeltaY() { return delta_y_; }
+
+SDL_Rect PhysicsObject::GetBox() { return box_; }
+
+SDL_Rect PhysicsObject::GetInterpolatedBox(float alpha) {
+  SDL_Rect box = box_;
+  box.y = static_cast<int>(std::floor(previous_y_ + (y_ - previous_y_) * alpha));
+  return box;
+}
+
+void PhysicsObject::ResetAllVariables() {
+  f_x_ = 0, f_y_ = 0;
+  v_x_ = 0, v_y_ = 0;
+  delta_x_ = 0, delta_y_ = 0;
+  friction_x_ = 0, friction_y_ = 0;
+}
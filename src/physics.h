@@ -0,0 +1,85 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include "block_ring.h"
+
+constexpr int kCollisionX = 1;
+constexpr int kCollisionY = 2;
+constexpr int kCollisionBoth = kCollisionX | kCollisionY;
+
+inline int CheckBoxCollision(const SDL_Rect &a, const SDL_Rect &b) {
+  // 分离轴算法
+  const int left_a = a.x;
+  const int right_a = a.x + a.w;
+  const int top_a = a.y;
+  const int bottom_a = a.y + a.h;
+  const int left_b = b.x;
+  const int right_b = b.x + b.w;
+  const int top_b = b.y;
+  const int bottom_b = b.y + b.h;
+
+  int result = kCollisionBoth;
+  if (right_a <= left_b || right_b <= left_a) {
+    result &= ~kCollisionX;
+  }
+  if (bottom_a <= top_b || bottom_b <= top_a) {
+    result &= ~kCollisionY;
+  }
+
+  return result;
+}
+
+// 符号函数
+inline float Sign(float f) { return f < 0.0f ? -1.0f : 1.0f; }
+
+struct HitDetectionResult {
+  bool hit_lower_border = false;
+  bool hit_upper_border = false;
+  int hit_block_id = -1;
+};
+
+// 一步之内的候选运动，碰到方块的那个轴停在接触的位置
+struct StepMotion {
+  float x_f, y_f;
+  // floor of x_f and y_f
+  int x, y;
+  float v_x, v_y;
+};
+
+// PhysicsObject和PhysicsWorld共用的碰撞处理，先横向再纵向
+// x is swept from the old position, then y from the resolved x, so a fast
+// body stops against the first block in its path instead of tunnelling
+// through it, also when a diagonal step clips a corner. box, x_f and y_f
+// are the body before the step, box in screen coordinates and blocks in world
+// coordinates offset by camera_x. Returns the index of the block that was hit
+// or -1.
+int ResolveBlockCollisions(const BlockRing &blocks, int camera_x,
+                           const SDL_Rect &box, float x_f, float y_f,
+                           StepMotion *motion);
+
+class PhysicsObject {
+ public:
+  void Init(const SDL_Rect &box);
+  void ApplyForce(float f_x, float f_y);
+  void ApplyVelocity(float v_x, float v_y);
+  void SetFriction(float friction_x, float friction_y);
+  // Advances the simulation by exactly dt seconds. The box is in screen
+  // coordinates, blocks are in world coordinates offset by camera_x.
+  HitDetectionResult Update(const BlockRing &blocks, int camera_x, float dt);
+  int GetDeltaX();
+  int GetDeltaY();
+  SDL_Rect GetBox();
+  // Box between the last two steps, alpha in [0, 1]
+  SDL_Rect GetInterpolatedBox(float alpha);
+
+ private:
+  void ResetAllVariables();
+
+  float x_, y_, previous_y_;
+  float f_x_, f_y_;
+  float v_x_, v_y_;
+  int delta_x_, delta_y_;
+  float friction_x_, friction_y_;
+  SDL_Rect box_;
+};
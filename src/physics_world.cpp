@@ -0,0 +1,193 @@
+#include "physics_world.h"
+
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "config.h"
+#include "simd.h"
+
+PhysicsWorld::PhysicsWorld(SimdLevel simd) {
+#ifdef HAKUSYU_X86
+  use_simd_ = simd != SimdLevel::kScalar;
+#endif
+}
+
+void PhysicsWorld::Clear() {
+  size_ = 0;
+  // 之后AddBody只初始化新物体自己的那一格，同一组里剩下的格子必须已经是零
+  for (std::vector<float> *v :
+       {&x_, &y_, &v_x_, &v_y_, &f_x_, &f_y_, &friction_x_, &friction_y_,
+        &new_x_f_, &new_y_f_, &new_v_x_, &new_v_y_}) {
+    std::fill(v->begin(), v->end(), 0.0f);
+  }
+  for (std::vector<int> *v : {&box_x_, &box_y_, &box_w_, &box_h_, &delta_x_,
+                              &delta_y_, &new_x_, &new_y_}) {
+    std::fill(v->begin(), v->end(), 0);
+  }
+}
+
+size_t PhysicsWorld::AddBody(const SDL_Rect &box) {
+  const size_t i = size_++;
+  const size_t padded = (size_ + 3) & ~static_cast<size_t>(3);
+  if (x_.size() < padded) {
+    for (std::vector<float> *v :
+         {&x_, &y_, &v_x_, &v_y_, &f_x_, &f_y_, &friction_x_, &friction_y_,
+          &new_x_f_, &new_y_f_, &new_v_x_, &new_v_y_}) {
+      v->resize(padded, 0.0f);
+    }
+    for (std::vector<int> *v : {&box_x_, &box_y_, &box_w_, &box_h_,
+                                &delta_x_, &delta_y_, &new_x_, &new_y_}) {
+      v->resize(padded, 0);
+    }
+  }
+  x_[i] = static_cast<float>(box.x);
+  y_[i] = static_cast<float>(box.y);
+  v_x_[i] = v_y_[i] = 0.0f;
+  f_x_[i] = f_y_[i] = 0.0f;
+  friction_x_[i] = friction_y_[i] = 0.0f;
+  box_x_[i] = box.x;
+  box_y_[i] = box.y;
+  box_w_[i] = box.w;
+  box_h_[i] = box.h;
+  delta_x_[i] = delta_y_[i] = 0;
+  return i;
+}
+
+size_t PhysicsWorld::GetSize() const { return size_; }
+
+void PhysicsWorld::ApplyForce(size_t i, float f_x, float f_y) {
+  f_x_[i] += f_x;
+  f_y_[i] += f_y;
+}
+
+void PhysicsWorld::ApplyVelocity(size_t i, float v_x, float v_y) {
+  v_x_[i] += v_x;
+  v_y_[i] += v_y;
+}
+
+void PhysicsWorld::SetFriction(size_t i, float friction_x, float friction_y) {
+  friction_x_[i] = friction_x;
+  friction_y_[i] = friction_y;
+}
+
+void PhysicsWorld::Update(const BlockRing &blocks, const int *camera_x,
+                          float dt, HitDetectionResult *results) {
+  Integrate(dt);
+  // 完全在最高的方块上方的物体不可能碰到方块，跳过二分查找
+  int highest_top = INT_MAX;
+  for (size_t j = 0; j < blocks.GetSize(); j++) {
+    highest_top = std::min(highest_top, blocks.Get(j).y);
+  }
+  for (size_t i = 0; i < size_; i++) {
+    const SDL_Rect box = {box_x_[i], box_y_[i], box_w_[i], box_h_[i]};
+    StepMotion motion = {new_x_f_[i], new_y_f_[i], new_x_[i],
+                         new_y_[i],   new_v_x_[i], new_v_y_[i]};
+    HitDetectionResult &result = results[i];
+    result.hit_block_id = -1;
+    if (std::max(box.y, motion.y) + box.h > highest_top) {
+      result.hit_block_id = ResolveBlockCollisions(blocks, camera_x[i], box,
+                                                   x_[i], y_[i], &motion);
+    }
+    delta_x_[i] = motion.x - box.x;
+    delta_y_[i] = motion.y - box.y;
+    x_[i] = motion.x_f - delta_x_[i];
+    y_[i] = motion.y_f;
+    box_y_[i] = motion.y;
+    v_x_[i] = motion.v_x;
+    v_y_[i] = motion.v_y;
+    result.hit_lower_border = motion.y >= kWindowHeight;
+    result.hit_upper_border = motion.y <= 0;
+  }
+}
+
+int PhysicsWorld::GetDeltaX(size_t i) const { return delta_x_[i]; }
+
+int PhysicsWorld::GetDeltaY(size_t i) const { return delta_y_[i]; }
+
+SDL_Rect PhysicsWorld::GetBox(size_t i) const {
+  return {box_x_[i], box_y_[i], box_w_[i], box_h_[i]};
+}
+
+void PhysicsWorld::Integrate(float dt) {
+#ifdef HAKUSYU_X86
+  if (use_simd_) {
+    IntegrateSSE2(dt);
+    return;
+  }
+#endif
+  IntegrateScalar(dt);
+}
+
+void PhysicsWorld::IntegrateScalar(float dt) {
+  for (size_t i = 0; i < size_; i++) {
+    const float v_x = v_x_[i], v_y = v_y_[i];
+    new_v_x_[i] =
+        v_x + (f_x_[i] - Sign(v_x) * friction_x_[i] * v_x * v_x) * dt;
+    new_v_y_[i] =
+        v_y + (f_y_[i] - Sign(v_y) * friction_y_[i] * v_y * v_y) * dt;
+    new_x_f_[i] = x_[i] + (new_v_x_[i] + v_x) * 0.5f * dt;
+    new_y_f_[i] = y_[i] + (new_v_y_[i] + v_y) * 0.5f * dt;
+    new_x_[i] = static_cast<int>(std::floor(new_x_f_[i]));
+    new_y_[i] = static_cast<int>(std::floor(new_y_f_[i]));
+  }
+}
+
+#ifdef HAKUSYU_X86
+
+namespace {
+
+// v < 0 ? -1 : 1，和Sign一样把-0当作正数
+__m128 Sign4(__m128 v) {
+  const __m128 negative = _mm_cmplt_ps(v, _mm_setzero_ps());
+  return _mm_or_ps(_mm_and_ps(negative, _mm_set1_ps(-1.0f)),
+                   _mm_andnot_ps(negative, _mm_set1_ps(1.0f)));
+}
+
+// SSE2没有floor，截断后对负的非整数减一
+__m128i Floor4(__m128 x) {
+  const __m128i truncated = _mm_cvttps_epi32(x);
+  const __m128 rounded_up = _mm_cmpgt_ps(_mm_cvtepi32_ps(truncated), x);
+  // 比较结果全1即整数-1
+  return _mm_add_epi32(truncated, _mm_castps_si128(rounded_up));
+}
+
+}  // namespace
+
+void PhysicsWorld::IntegrateSSE2(float dt) {
+  const __m128 dt4 = _mm_set1_ps(dt);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const size_t padded = (size_ + 3) & ~static_cast<size_t>(3);
+  for (size_t i = 0; i < padded; i += 4) {
+    const __m128 v_x = _mm_loadu_ps(&v_x_[i]);
+    const __m128 v_y = _mm_loadu_ps(&v_y_[i]);
+    const __m128 drag_x = _mm_mul_ps(
+        _mm_mul_ps(_mm_mul_ps(Sign4(v_x), _mm_loadu_ps(&friction_x_[i])),
+                   v_x),
+        v_x);
+    const __m128 drag_y = _mm_mul_ps(
+        _mm_mul_ps(_mm_mul_ps(Sign4(v_y), _mm_loadu_ps(&friction_y_[i])),
+                   v_y),
+        v_y);
+    const __m128 new_v_x = _mm_add_ps(
+        v_x, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&f_x_[i]), drag_x), dt4));
+    const __m128 new_v_y = _mm_add_ps(
+        v_y, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&f_y_[i]), drag_y), dt4));
+    const __m128 new_x_f = _mm_add_ps(
+        _mm_loadu_ps(&x_[i]),
+        _mm_mul_ps(_mm_mul_ps(_mm_add_ps(new_v_x, v_x), half), dt4));
+    const __m128 new_y_f = _mm_add_ps(
+        _mm_loadu_ps(&y_[i]),
+        _mm_mul_ps(_mm_mul_ps(_mm_add_ps(new_v_y, v_y), half), dt4));
+    _mm_storeu_ps(&new_v_x_[i], new_v_x);
+    _mm_storeu_ps(&new_v_y_[i], new_v_y);
+    _mm_storeu_ps(&new_x_f_[i], new_x_f);
+    _mm_storeu_ps(&new_y_f_[i], new_y_f);
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&new_x_[i]),
+                     Floor4(new_x_f));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(&new_y_[i]),
+                     Floor4(new_y_f));
+  }
+}
+
+#endif
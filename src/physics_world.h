@@ -0,0 +1,51 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+#include "block_ring.h"
+#include "physics.h"
+#include "simd.h"
+
+// 结构数组形式的物理世界，一次推进N个物体，积分部分用SIMD四个一组计算
+// Same integration and collision rules as PhysicsObject::Update. The SIMD
+// path evaluates the same expressions in the same order, so the results
+// equal N separate PhysicsObjects exactly.
+class PhysicsWorld {
+ public:
+  explicit PhysicsWorld(SimdLevel simd = GetSimdLevel());
+
+  void Clear();
+  // Same as PhysicsObject::Init, returns the index of the new body
+  size_t AddBody(const SDL_Rect &box);
+  size_t GetSize() const;
+  void ApplyForce(size_t i, float f_x, float f_y);
+  void ApplyVelocity(size_t i, float v_x, float v_y);
+  void SetFriction(size_t i, float friction_x, float friction_y);
+  // Advances every body by dt seconds. Body i collides with the blocks
+  // offset by camera_x[i], results receives GetSize() entries.
+  void Update(const BlockRing &blocks, const int *camera_x, float dt,
+              HitDetectionResult *results);
+  int GetDeltaX(size_t i) const;
+  int GetDeltaY(size_t i) const;
+  SDL_Rect GetBox(size_t i) const;
+
+ private:
+  void Integrate(float dt);
+  void IntegrateScalar(float dt);
+  void IntegrateSSE2(float dt);
+
+  bool use_simd_ = false;
+  size_t size_ = 0;
+  // 长度补齐到4的倍数，补出来的物体全为零，Clear之后也一样，不参与碰撞
+  std::vector<float> x_, y_;
+  std::vector<float> v_x_, v_y_;
+  std::vector<float> f_x_, f_y_;
+  std::vector<float> friction_x_, friction_y_;
+  std::vector<int> box_x_, box_y_, box_w_, box_h_;
+  std::vector<int> delta_x_, delta_y_;
+  // Candidate motion of the current step before collisions
+  std::vector<float> new_x_f_, new_y_f_, new_v_x_, new_v_y_;
+  std::vector<int> new_x_, new_y_;
+};
@@ -0,0 +1,85 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+FrameProfiler &FrameProfiler::Get() {
+  static FrameProfiler profiler;
+  return profiler;
+}
+
+const char *FrameProfiler::GetStageName(ProfileStage stage) {
+  switch (stage) {
+    case ProfileStage::kAmplitude:
+      return "amplitude";
+    case ProfileStage::kPhysics:
+      return "physics";
+    case ProfileStage::kShiftBlocks:
+      return "shift_blocks";
+    case ProfileStage::kDraw:
+      return "draw";
+    case ProfileStage::kPresent:
+      return "present";
+    default:
+      return "unknown";
+  }
+}
+
+FrameProfiler::FrameProfiler()
+    : microseconds_per_tick_(1e6 / SDL_GetPerformanceFrequency()) {
+  for (std::atomic<Uint64> &c : current_) {
+    c.store(0, std::memory_order_relaxed);
+  }
+}
+
+void FrameProfiler::AddSample(ProfileStage stage, Uint64 ticks) {
+  current_[static_cast<int>(stage)].fetch_add(ticks,
+                                              std::memory_order_relaxed);
+}
+
+void FrameProfiler::EndFrame() {
+  const int slot = static_cast<int>(frame_count_ % kFrameHistory);
+  for (int s = 0; s < kProfileStageCount; s++) {
+    const Uint64 ticks = current_[s].exchange(0, std::memory_order_relaxed);
+    history_[s][slot] = ticks;
+    const int bucket = static_cast<int>(ticks * microseconds_per_tick_ /
+                                        kHistogramBucketMicroseconds);
+    histograms_[s][std::min(bucket, kHistogramBuckets - 1)]++;
+  }
+  frame_count_++;
+}
+
+float FrameProfiler::GetPercentile(ProfileStage stage, float percentile) {
+  const int n = static_cast<int>(
+      std::min<Uint64>(frame_count_, static_cast<Uint64>(kFrameHistory)));
+  if (n == 0) {
+    return 0.0f;
+  }
+  Uint64 samples[kFrameHistory];
+  std::copy(history_[static_cast<int>(stage)],
+            history_[static_cast<int>(stage)] + n, samples);
+  const int k = std::min(n - 1, static_cast<int>(percentile * n));
+  std::nth_element(samples, samples + k, samples + n);
+  return static_cast<float>(samples[k] * microseconds_per_tick_ / 1000.0);
+}
+
+bool FrameProfiler::WriteCsv(const char *path) {
+  std::FILE *f = std::fopen(path, "w");
+  if (f == nullptr) {
+    return false;
+  }
+  std::fprintf(f, "stage,bucket_begin_us,bucket_end_us,frames\n");
+  for (int s = 0; s < kProfileStageCount; s++) {
+    for (int b = 0; b < kHistogramBuckets; b++) {
+      if (histograms_[s][b] == 0) {
+        continue;
+      }
+      std::fprintf(f, "%s,%d,%d,%u\n",
+                   GetStageName(static_cast<ProfileStage>(s)),
+                   b * kHistogramBucketMicroseconds,
+                   (b + 1) * kHistogramBucketMicroseconds, histograms_[s][b]);
+    }
+  }
+  std::fclose(f);
+  return true;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <atomic>
+
+// 每帧分阶段的耗时统计，只在定义了HAKUSYU_PROFILE时编译进热路径
+// Use HAKUSYU_PROFILE_SCOPE / HAKUSYU_PROFILE_END_FRAME instead of calling the
+// profiler directly, they expand to nothing when profiling is off.
+
+enum class ProfileStage {
+  kAmplitude,
+  kPhysics,
+  kShiftBlocks,
+  kDraw,
+  kPresent,
+  kCount,
+};
+
+constexpr int kProfileStageCount = static_cast<int>(ProfileStage::kCount);
+
+class FrameProfiler {
+ public:
+  static constexpr int kFrameHistory = 256;
+  static constexpr int kHistogramBucketMicroseconds = 20;
+  static constexpr int kHistogramBuckets = 2500;
+
+  static FrameProfiler &Get();
+  static const char *GetStageName(ProfileStage stage);
+
+  // Can be called from any thread, samples of one stage add up within a frame
+  void AddSample(ProfileStage stage, Uint64 ticks);
+  // Commits the current frame into the rolling window and the histograms
+  void EndFrame();
+  // Over the last kFrameHistory frames, in milliseconds
+  float GetPercentile(ProfileStage stage, float percentile);
+  bool WriteCsv(const char *path);
+
+ private:
+  FrameProfiler();
+
+  double microseconds_per_tick_;
+  std::atomic<Uint64> current_[kProfileStageCount];
+  Uint64 history_[kProfileStageCount][kFrameHistory] = {};
+  Uint64 frame_count_ = 0;
+  Uint32 histograms_[kProfileStageCount][kHistogramBuckets] = {};
+};
+
+class ProfileScope {
+ public:
+  explicit ProfileScope(ProfileStage stage)
+      : stage_(stage), begin_(SDL_GetPerformanceCounter()) {}
+  ~ProfileScope() {
+    FrameProfiler::Get().AddSample(stage_,
+                                   SDL_GetPerformanceCounter() - begin_);
+  }
+
+ private:
+  ProfileStage stage_;
+  Uint64 begin_;
+};
+
+#ifdef HAKUSYU_PROFILE
+#define HAKUSYU_PROFILE_CONCAT_(a, b) a##b
+#define HAKUSYU_PROFILE_CONCAT(a, b) HAKUSYU_PROFILE_CONCAT_(a, b)
+#define HAKUSYU_PROFILE_SCOPE(stage) \
+  ProfileScope HAKUSYU_PROFILE_CONCAT(profile_scope_, __LINE__)(stage)
+#define HAKUSYU_PROFILE_END_FRAME() FrameProfiler::Get().EndFrame()
+#else
+#define HAKUSYU_PROFILE_SCOPE(stage)
+#define HAKUSYU_PROFILE_END_FRAME()
+#endif
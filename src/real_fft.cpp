@@ -0,0 +1,146 @@
+#include "real_fft.h"
+
+#include <cmath>
+
+#include "game_error.h"
+#include "simd.h"
+
+constexpr double kPi = 3.14159265358979323846;
+
+void RealFft::Init(int size, SimdLevel simd) {
+  if (size < 8 || (size & (size - 1)) != 0) {
+    throw GameError("FFT size must be a power of two");
+  }
+  size_ = size;
+#ifdef HAKUSYU_X86
+  use_simd_ = simd != SimdLevel::kScalar;
+#else
+  use_simd_ = false;
+#endif
+
+  const int m = size / 2;
+  int bits = 0;
+  while ((1 << bits) < m) {
+    bits++;
+  }
+  bit_reverse_.assign(m, 0);
+  for (int n = 0; n < m; n++) {
+    int r = 0;
+    for (int b = 0; b < bits; b++) {
+      r |= ((n >> b) & 1) << (bits - 1 - b);
+    }
+    bit_reverse_[n] = r;
+  }
+
+  stage_re_.assign(m > 1 ? m - 1 : 0, 0.0f);
+  stage_im_.assign(stage_re_.size(), 0.0f);
+  for (int half = 1; half < m; half *= 2) {
+    for (int k = 0; k < half; k++) {
+      const double angle = -kPi * k / half;
+      stage_re_[half - 1 + k] = static_cast<float>(std::cos(angle));
+      stage_im_[half - 1 + k] = static_cast<float>(std::sin(angle));
+    }
+  }
+  split_re_.assign(m + 1, 0.0f);
+  split_im_.assign(m + 1, 0.0f);
+  for (int k = 0; k <= m; k++) {
+    const double angle = -2.0 * kPi * k / size;
+    split_re_[k] = static_cast<float>(std::cos(angle));
+    split_im_[k] = static_cast<float>(std::sin(angle));
+  }
+  re_.assign(m, 0.0f);
+  im_.assign(m, 0.0f);
+}
+
+int RealFft::GetSize() const { return size_; }
+
+void RealFft::PowerSpectrum(const float *input, float *power) {
+  const int m = size_ / 2;
+  // 偶数下标当实部、奇数下标当虚部，按位反转的顺序放好
+  for (int n = 0; n < m; n++) {
+    re_[bit_reverse_[n]] = input[2 * n];
+    im_[bit_reverse_[n]] = input[2 * n + 1];
+  }
+  Butterflies();
+
+  // X[k] = E[k] + W^k O[k]，E和O由Z[k]和conj(Z[m - k])得到
+  for (int k = 0; k <= m; k++) {
+    const int a = k % m;
+    const int b = (m - k) % m;
+    const float e_re = 0.5f * (re_[a] + re_[b]);
+    const float e_im = 0.5f * (im_[a] - im_[b]);
+    const float o_re = 0.5f * (im_[a] + im_[b]);
+    const float o_im = -0.5f * (re_[a] - re_[b]);
+    const float x_re = e_re + split_re_[k] * o_re - split_im_[k] * o_im;
+    const float x_im = e_im + split_re_[k] * o_im + split_im_[k] * o_re;
+    power[k] = x_re * x_re + x_im * x_im;
+  }
+}
+
+void RealFft::Butterflies() {
+  const int m = size_ / 2;
+  for (int half = 1; half < m; half *= 2) {
+    const float *w_re = stage_re_.data() + half - 1;
+    const float *w_im = stage_im_.data() + half - 1;
+#ifdef HAKUSYU_X86
+    if (use_simd_ && half >= 4) {
+      ButterfliesSSE2(half, w_re, w_im);
+      continue;
+    }
+#endif
+    ButterfliesScalar(half, w_re, w_im);
+  }
+}
+
+void RealFft::ButterfliesScalar(int half, const float *w_re,
+                                const float *w_im) {
+  const int m = size_ / 2;
+  for (int j = 0; j < m; j += 2 * half) {
+    for (int k = 0; k < half; k++) {
+      const int top = j + k;
+      const int bottom = top + half;
+      const float t_re = w_re[k] * re_[bottom] - w_im[k] * im_[bottom];
+      const float t_im = w_re[k] * im_[bottom] + w_im[k] * re_[bottom];
+      re_[bottom] = re_[top] - t_re;
+      im_[bottom] = im_[top] - t_im;
+      re_[top] = re_[top] + t_re;
+      im_[top] = im_[top] + t_im;
+    }
+  }
+}
+
+#ifdef HAKUSYU_X86
+
+void RealFft::ButterfliesSSE2(int half, const float *w_re,
+                              const float *w_im) {
+  const int m = size_ / 2;
+  float *re = re_.data();
+  float *im = im_.data();
+  for (int j = 0; j < m; j += 2 * half) {
+    for (int k = 0; k < half; k += 4) {
+      const int top = j + k;
+      const int bottom = top + half;
+      const __m128 wr = _mm_loadu_ps(w_re + k);
+      const __m128 wi = _mm_loadu_ps(w_im + k);
+      const __m128 br = _mm_loadu_ps(re + bottom);
+      const __m128 bi = _mm_loadu_ps(im + bottom);
+      const __m128 tr = _mm_sub_ps(_mm_mul_ps(wr, br), _mm_mul_ps(wi, bi));
+      const __m128 ti = _mm_add_ps(_mm_mul_ps(wr, bi), _mm_mul_ps(wi, br));
+      const __m128 ar = _mm_loadu_ps(re + top);
+      const __m128 ai = _mm_loadu_ps(im + top);
+      _mm_storeu_ps(re + bottom, _mm_sub_ps(ar, tr));
+      _mm_storeu_ps(im + bottom, _mm_sub_ps(ai, ti));
+      _mm_storeu_ps(re + top, _mm_add_ps(ar, tr));
+      _mm_storeu_ps(im + top, _mm_add_ps(ai, ti));
+    }
+  }
+}
+
+#else
+
+void RealFft::ButterfliesSSE2(int half, const float *w_re,
+                              const float *w_im) {
+  ButterfliesScalar(half, w_re, w_im);
+}
+
+#endif
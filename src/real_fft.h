@@ -0,0 +1,37 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+#include "simd.h"
+
+// 实数输入的FFT：N个实数打包成N/2个复数做基2变换，再拆出N/2+1个频点
+// Real and imaginary parts are kept in separate arrays, so the butterflies of
+// every stage wider than four run four at a time with SSE2. Both kernels do
+// the same float operations in the same order and produce bit-identical
+// spectra.
+class RealFft {
+ public:
+  // size is a power of two, at least 8
+  void Init(int size, SimdLevel simd = GetSimdLevel());
+  int GetSize() const;
+  // Writes |X[k]|^2 for k in [0, size / 2] to power. Not thread-safe, the
+  // instance keeps its working buffers.
+  void PowerSpectrum(const float *input, float *power);
+
+ private:
+  void Butterflies();
+  void ButterfliesScalar(int half, const float *w_re, const float *w_im);
+  void ButterfliesSSE2(int half, const float *w_re, const float *w_im);
+
+  int size_ = 0;
+  bool use_simd_ = false;
+  std::vector<int> bit_reverse_;
+  // Twiddles of all stages back to back, the stage with half-width h starts
+  // at h - 1
+  std::vector<float> stage_re_, stage_im_;
+  // e^(-2 pi i k / size) for the final split, k in [0, size / 2]
+  std::vector<float> split_re_, split_im_;
+  std::vector<float> re_, im_;
+};
@@ -0,0 +1,117 @@
+#include "render_batch.h"
+
+#include <algorithm>
+
+namespace {
+
+Uint32 PackColor(SDL_Color c) {
+  return (static_cast<Uint32>(c.r) << 24) | (static_cast<Uint32>(c.g) << 16) |
+         (static_cast<Uint32>(c.b) << 8) | c.a;
+}
+
+}  // namespace
+
+void RenderBatch::Clear() {
+  for (RectGroup &group : rect_groups_) {
+    group.rects.clear();
+  }
+  for (TextureGroup &group : texture_groups_) {
+    group.vertices.clear();
+    group.indices.clear();
+  }
+}
+
+void RenderBatch::AddRect(SDL_Color color, const SDL_Rect &rect) {
+  GetRectGroup(color).rects.push_back(rect);
+}
+
+void RenderBatch::AddTexture(SDL_Texture *texture, const SDL_Rect *source,
+                             const SDL_Rect &target) {
+  TextureGroup &group = GetTextureGroup(texture);
+  SDL_Rect s = {0, 0, static_cast<int>(group.width),
+                static_cast<int>(group.height)};
+  if (source != nullptr) {
+    s = *source;
+  }
+  const float u0 = s.x / group.width, u1 = (s.x + s.w) / group.width;
+  const float v0 = s.y / group.height, v1 = (s.y + s.h) / group.height;
+  const float x0 = static_cast<float>(target.x);
+  const float x1 = static_cast<float>(target.x + target.w);
+  const float y0 = static_cast<float>(target.y);
+  const float y1 = static_cast<float>(target.y + target.h);
+  const SDL_Color white = {0xFF, 0xFF, 0xFF, 0xFF};
+  const int base = static_cast<int>(group.vertices.size());
+  group.vertices.push_back({{x0, y0}, white, {u0, v0}});
+  group.vertices.push_back({{x1, y0}, white, {u1, v0}});
+  group.vertices.push_back({{x1, y1}, white, {u1, v1}});
+  group.vertices.push_back({{x0, y1}, white, {u0, v1}});
+  for (int i : {0, 1, 2, 0, 2, 3}) {
+    group.indices.push_back(base + i);
+  }
+}
+
+void RenderBatch::ReserveRects(SDL_Color color, size_t count) {
+  GetRectGroup(color).rects.reserve(count);
+}
+
+void RenderBatch::ReserveQuads(SDL_Texture *texture, size_t count) {
+  TextureGroup &group = GetTextureGroup(texture);
+  group.vertices.reserve(count * 4);
+  group.indices.reserve(count * 6);
+}
+
+int RenderBatch::Flush(SDL_Renderer *renderer) {
+  int draw_calls = 0;
+  // 不同颜色的方块互不重叠，按颜色排序只为了顺序稳定
+  std::sort(rect_groups_.begin(), rect_groups_.end(),
+            [](const RectGroup &a, const RectGroup &b) {
+              return PackColor(a.color) < PackColor(b.color);
+            });
+  for (const RectGroup &group : rect_groups_) {
+    if (group.rects.empty()) {
+      continue;
+    }
+    const SDL_Color &c = group.color;
+    SDL_SetRenderDrawColor(renderer, c.r, c.g, c.b, c.a);
+    SDL_RenderFillRects(renderer, group.rects.data(),
+                        static_cast<int>(group.rects.size()));
+    draw_calls++;
+  }
+  for (const TextureGroup &group : texture_groups_) {
+    if (group.indices.empty()) {
+      continue;
+    }
+    SDL_RenderGeometry(renderer, group.texture, group.vertices.data(),
+                       static_cast<int>(group.vertices.size()),
+                       group.indices.data(),
+                       static_cast<int>(group.indices.size()));
+    draw_calls++;
+  }
+  Clear();
+  return draw_calls;
+}
+
+RenderBatch::RectGroup &RenderBatch::GetRectGroup(SDL_Color color) {
+  // 颜色只有几种，线性查找就够了
+  const Uint32 key = PackColor(color);
+  for (RectGroup &group : rect_groups_) {
+    if (PackColor(group.color) == key) {
+      return group;
+    }
+  }
+  rect_groups_.push_back({color, {}});
+  return rect_groups_.back();
+}
+
+RenderBatch::TextureGroup &RenderBatch::GetTextureGroup(SDL_Texture *texture) {
+  for (TextureGroup &group : texture_groups_) {
+    if (group.texture == texture) {
+      return group;
+    }
+  }
+  int w, h;
+  SDL_QueryTexture(texture, nullptr, nullptr, &w, &h);
+  texture_groups_.push_back(
+      {texture, static_cast<float>(w), static_cast<float>(h), {}, {}});
+  return texture_groups_.back();
+}
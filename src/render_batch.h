@@ -0,0 +1,46 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+// 每帧的绘制命令缓冲，按颜色和纹理分组后一次性提交
+// Rects of one color become a single SDL_RenderFillRects call and quads of one
+// texture a single SDL_RenderGeometry call, so the number of draw calls only
+// depends on how many colors and textures are used, not on how many blocks or
+// glyphs are visible. Rects are drawn below textures, textures are drawn in
+// the order they were first added.
+class RenderBatch {
+ public:
+  // Keeps the allocated storage for the next frame
+  void Clear();
+  void AddRect(SDL_Color color, const SDL_Rect &rect);
+  // source may be nullptr to draw the whole texture
+  void AddTexture(SDL_Texture *texture, const SDL_Rect *source,
+                  const SDL_Rect &target);
+  // Creates the group up front with room for count rects or quads, drawing
+  // up to that many per frame then never allocates
+  void ReserveRects(SDL_Color color, size_t count);
+  void ReserveQuads(SDL_Texture *texture, size_t count);
+  // Submits and clears the batch. Returns the number of draw calls issued.
+  int Flush(SDL_Renderer *renderer);
+
+ private:
+  struct RectGroup {
+    SDL_Color color;
+    std::vector<SDL_Rect> rects;
+  };
+  struct TextureGroup {
+    SDL_Texture *texture;
+    float width;
+    float height;
+    std::vector<SDL_Vertex> vertices;
+    std::vector<int> indices;
+  };
+
+  RectGroup &GetRectGroup(SDL_Color color);
+  TextureGroup &GetTextureGroup(SDL_Texture *texture);
+
+  std::vector<RectGroup> rect_groups_;
+  std::vector<TextureGroup> texture_groups_;
+};
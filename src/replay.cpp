@@ -0,0 +1,304 @@
+#include "replay.h"
+
+#include <cstring>
+
+#include "game_error.h"
+
+constexpr char kReplayMagic[4] = {'H', 'K', 'R', 'P'};
+constexpr Uint8 kReplayVersion = 1;
+constexpr size_t kReplayHeaderSize = sizeof(kReplayMagic) + 1;
+
+namespace {
+
+// SessionParams按固定的顺序读写
+constexpr int kParamCount = 7;
+static_assert(sizeof(SessionParams) == kParamCount * sizeof(float),
+              "Update the replay format together with SessionParams");
+
+void GetParamFields(SessionParams *params, float *fields[kParamCount]) {
+  fields[0] = &params->amplitude_to_vertical_speed;
+  fields[1] = &params->amplitude_to_horizontal_speed;
+  fields[2] = &params->amplitude_to_clap_speed;
+  fields[3] = &params->friction_horizontal;
+  fields[4] = &params->friction_vertical;
+  fields[5] = &params->gravity;
+  fields[6] = &params->time_step;
+}
+
+}  // namespace
+
+ReplayWriter::~ReplayWriter() { Close(); }
+
+void ReplayWriter::Open(const char *path) {
+  Close();
+  file_ = std::fopen(path, "ab");
+  if (file_ == nullptr) {
+    throw GameError("Cannot open replay file");
+  }
+  std::fseek(file_, 0, SEEK_END);
+  if (std::ftell(file_) == 0) {
+    std::fwrite(kReplayMagic, 1, sizeof(kReplayMagic), file_);
+    WriteByte(kReplayVersion);
+  }
+}
+
+void ReplayWriter::Close() {
+  if (file_ != nullptr) {
+    FlushSteps();
+    std::fclose(file_);
+    file_ = nullptr;
+  }
+}
+
+bool ReplayWriter::IsOpen() { return file_ != nullptr; }
+
+void ReplayWriter::BeginGame(Uint64 seed, int character_width,
+                             int character_height,
+                             const SessionParams &params) {
+  // 上一局中途退出时还有没写出的步数
+  FlushSteps();
+  WriteByte(static_cast<Uint8>(ReplayRecord::kGame));
+  WriteU64(seed);
+  WriteU32(static_cast<Uint32>(character_width));
+  WriteU32(static_cast<Uint32>(character_height));
+  SessionParams copy = params;
+  float *fields[kParamCount];
+  GetParamFields(&copy, fields);
+  for (float *field : fields) {
+    WriteFloat(*field);
+  }
+}
+
+void ReplayWriter::AddClap(float strength) {
+  FlushSteps();
+  WriteByte(static_cast<Uint8>(ReplayRecord::kClap));
+  WriteFloat(strength);
+}
+
+void ReplayWriter::AddSteps(float relative_amplitude, int count) {
+  if (count <= 0) {
+    return;
+  }
+  // 按位比较，回放时必须是完全相同的浮点数
+  if (pending_steps_ > 0 &&
+      std::memcmp(&pending_amplitude_, &relative_amplitude, sizeof(float)) !=
+          0) {
+    FlushSteps();
+  }
+  pending_amplitude_ = relative_amplitude;
+  pending_steps_ += count;
+}
+
+void ReplayWriter::AddShift(int pixels) {
+  FlushSteps();
+  WriteByte(static_cast<Uint8>(ReplayRecord::kShift));
+  WriteU32(static_cast<Uint32>(pixels));
+}
+
+void ReplayWriter::AddVelocity(float v_x, float v_y) {
+  FlushSteps();
+  WriteByte(static_cast<Uint8>(ReplayRecord::kVelocity));
+  WriteFloat(v_x);
+  WriteFloat(v_y);
+}
+
+void ReplayWriter::EndGame(int score, int camera_x, const SDL_Rect &box) {
+  FlushSteps();
+  WriteByte(static_cast<Uint8>(ReplayRecord::kEnd));
+  WriteVarint(static_cast<Uint64>(score));
+  WriteU32(static_cast<Uint32>(camera_x));
+  WriteU32(static_cast<Uint32>(box.x));
+  WriteU32(static_cast<Uint32>(box.y));
+  WriteU32(static_cast<Uint32>(box.w));
+  WriteU32(static_cast<Uint32>(box.h));
+  std::fflush(file_);
+}
+
+void ReplayWriter::FlushSteps() {
+  if (pending_steps_ == 0) {
+    return;
+  }
+  WriteByte(static_cast<Uint8>(ReplayRecord::kSteps));
+  WriteFloat(pending_amplitude_);
+  WriteVarint(pending_steps_);
+  pending_steps_ = 0;
+}
+
+void ReplayWriter::WriteByte(Uint8 value) { std::fputc(value, file_); }
+
+void ReplayWriter::WriteU32(Uint32 value) {
+  for (int i = 0; i < 4; i++) {
+    WriteByte(static_cast<Uint8>(value >> (i * 8)));
+  }
+}
+
+void ReplayWriter::WriteU64(Uint64 value) {
+  WriteU32(static_cast<Uint32>(value));
+  WriteU32(static_cast<Uint32>(value >> 32));
+}
+
+void ReplayWriter::WriteFloat(float value) {
+  Uint32 bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  WriteU32(bits);
+}
+
+void ReplayWriter::WriteVarint(Uint64 value) {
+  while (value >= 0x80) {
+    WriteByte(static_cast<Uint8>(value | 0x80));
+    value >>= 7;
+  }
+  WriteByte(static_cast<Uint8>(value));
+}
+
+void ReplayReader::Open(const char *path) {
+  file_.Open(path);
+  if (file_.GetSize() < kReplayHeaderSize ||
+      std::memcmp(file_.GetData(), kReplayMagic, sizeof(kReplayMagic)) != 0) {
+    throw GameError("Not a replay file");
+  }
+  if (file_.GetData()[sizeof(kReplayMagic)] != kReplayVersion) {
+    throw GameError("Unsupported replay version");
+  }
+  inputs_ = kReplayHeaderSize;
+  next_game_ = kReplayHeaderSize;
+}
+
+bool ReplayReader::NextGame(ReplayGame *game) {
+  size_t position = next_game_;
+  if (position >= file_.GetSize()) {
+    return false;
+  }
+  if (file_.GetData()[position++] != static_cast<Uint8>(ReplayRecord::kGame)) {
+    throw GameError("Corrupt replay file");
+  }
+  *game = ReplayGame();
+  game->seed = ReadU64(&position);
+  game->character_width = static_cast<int>(ReadU32(&position));
+  game->character_height = static_cast<int>(ReadU32(&position));
+  float *fields[kParamCount];
+  GetParamFields(&game->params, fields);
+  for (float *field : fields) {
+    *field = ReadFloat(&position);
+  }
+  inputs_ = position;
+
+  // 跳过输入找到结束记录，校验要用
+  ReplayInput input;
+  while (ReadInput(&position, &input)) {
+  }
+  if (input.record == ReplayRecord::kEnd) {
+    game->has_end = true;
+    game->score = static_cast<int>(ReadVarint(&position));
+    game->camera_x = static_cast<int>(ReadU32(&position));
+    game->box.x = static_cast<int>(ReadU32(&position));
+    game->box.y = static_cast<int>(ReadU32(&position));
+    game->box.w = static_cast<int>(ReadU32(&position));
+    game->box.h = static_cast<int>(ReadU32(&position));
+  }
+  next_game_ = position;
+  return true;
+}
+
+Uint64 ReplayReader::Play(GameSession *session) {
+  size_t position = inputs_;
+  ReplayInput input;
+  Uint64 steps = 0;
+  while (ReadInput(&position, &input)) {
+    switch (input.record) {
+      case ReplayRecord::kClap:
+        session->ApplyClap(input.value);
+        break;
+      case ReplayRecord::kShift:
+        session->ShiftBlocks(input.pixels);
+        break;
+      case ReplayRecord::kVelocity:
+        session->GetPhysicsObject().ApplyVelocity(input.v_x, input.v_y);
+        break;
+      default:
+        for (Uint64 i = 0; i < input.count; i++) {
+          steps++;
+          if (!session->Step(input.value)) {
+            return steps;
+          }
+        }
+        break;
+    }
+  }
+  return steps;
+}
+
+bool ReplayReader::ReadInput(size_t *position, ReplayInput *input) {
+  // 文件结尾和下一局的开头都算作这一局没有结束记录
+  *input = ReplayInput();
+  if (*position >= file_.GetSize()) {
+    return false;
+  }
+  const Uint8 tag = file_.GetData()[*position];
+  if (tag == static_cast<Uint8>(ReplayRecord::kGame)) {
+    return false;
+  }
+  (*position)++;
+  input->record = static_cast<ReplayRecord>(tag);
+  switch (input->record) {
+    case ReplayRecord::kEnd:
+      return false;
+    case ReplayRecord::kClap:
+      input->value = ReadFloat(position);
+      return true;
+    case ReplayRecord::kSteps:
+      input->value = ReadFloat(position);
+      input->count = ReadVarint(position);
+      return true;
+    case ReplayRecord::kShift:
+      input->pixels = static_cast<int>(ReadU32(position));
+      return true;
+    case ReplayRecord::kVelocity:
+      input->v_x = ReadFloat(position);
+      input->v_y = ReadFloat(position);
+      return true;
+    default:
+      throw GameError("Corrupt replay file");
+  }
+}
+
+void ReplayReader::Read(size_t *position, void *out, size_t size) {
+  if (file_.GetSize() - *position < size) {
+    throw GameError("Truncated replay file");
+  }
+  std::memcpy(out, file_.GetData() + *position, size);
+  *position += size;
+}
+
+Uint32 ReplayReader::ReadU32(size_t *position) {
+  Uint8 bytes[4];
+  Read(position, bytes, sizeof(bytes));
+  return static_cast<Uint32>(bytes[0]) | (static_cast<Uint32>(bytes[1]) << 8) |
+         (static_cast<Uint32>(bytes[2]) << 16) |
+         (static_cast<Uint32>(bytes[3]) << 24);
+}
+
+Uint64 ReplayReader::ReadU64(size_t *position) {
+  const Uint64 low = ReadU32(position);
+  return low | (static_cast<Uint64>(ReadU32(position)) << 32);
+}
+
+float ReplayReader::ReadFloat(size_t *position) {
+  const Uint32 bits = ReadU32(position);
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+Uint64 ReplayReader::ReadVarint(size_t *position) {
+  Uint64 value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    Uint8 byte;
+    Read(position, &byte, 1);
+    value |= static_cast<Uint64>(byte & 0x7F) << shift;
+    if ((byte & 0x80) == 0) {
+      return value;
+    }
+  }
+  throw GameError("Corrupt replay file");
+}
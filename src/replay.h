@@ -0,0 +1,115 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <cstdio>
+
+#include "mapped_file.h"
+#include "session.h"
+
+// 对局回放：只追加写入的二进制日志，记录关卡种子和模拟线程每次迭代的输入
+// The simulation is deterministic given the seed, the parameters and the
+// sequence of claps and steps, so that is all a replay needs. Layout, little
+// endian, counts as LEB128 varints:
+//   file    "HKRP", version byte, then any number of games
+//   game    kGame, seed u64, character width and height i32, SessionParams
+//           as seven f32, then inputs
+//   input   kClap strength f32 | kSteps amplitude f32, count varint
+//           | kShift pixels i32 | kVelocity v_x f32, v_y f32
+//   end     kEnd score varint, camera_x i32, character box four i32
+// Consecutive steps with the same amplitude share one record. kShift and
+// kVelocity are the debug keys of the game. A game that was quit before it
+// ended has no end record.
+
+enum class ReplayRecord : Uint8 {
+  kGame = 1,
+  kClap = 2,
+  kSteps = 3,
+  kEnd = 4,
+  kShift = 5,
+  kVelocity = 6,
+};
+
+// One input record of a game
+struct ReplayInput {
+  ReplayRecord record = ReplayRecord::kGame;
+  // Clap strength or amplitude of the steps
+  float value = 0.0f;
+  Uint64 count = 0;
+  int pixels = 0;
+  float v_x = 0.0f, v_y = 0.0f;
+};
+
+struct ReplayGame {
+  Uint64 seed = 0;
+  int character_width = 0;
+  int character_height = 0;
+  SessionParams params;
+  // Only valid when the game was played to its end
+  bool has_end = false;
+  int score = 0;
+  int camera_x = 0;
+  SDL_Rect box = {0, 0, 0, 0};
+};
+
+// Simulation thread only while a game is running
+class ReplayWriter {
+ public:
+  ReplayWriter() = default;
+  ReplayWriter(const ReplayWriter &) = delete;
+  ReplayWriter &operator=(const ReplayWriter &) = delete;
+  ~ReplayWriter();
+
+  // Appends to the file, throws GameError if it cannot be opened
+  void Open(const char *path);
+  void Close();
+  bool IsOpen();
+  void BeginGame(Uint64 seed, int character_width, int character_height,
+                 const SessionParams &params);
+  void AddClap(float strength);
+  void AddSteps(float relative_amplitude, int count);
+  // GameSession::ShiftBlocks
+  void AddShift(int pixels);
+  // ApplyVelocity on the character
+  void AddVelocity(float v_x, float v_y);
+  void EndGame(int score, int camera_x, const SDL_Rect &box);
+
+ private:
+  void FlushSteps();
+  void WriteByte(Uint8 value);
+  void WriteU32(Uint32 value);
+  void WriteU64(Uint64 value);
+  void WriteFloat(float value);
+  void WriteVarint(Uint64 value);
+
+  std::FILE *file_ = nullptr;
+  float pending_amplitude_ = 0.0f;
+  Uint64 pending_steps_ = 0;
+};
+
+class ReplayReader {
+ public:
+  // Throws GameError if the file is not a replay
+  void Open(const char *path);
+  // Moves to the next game and scans ahead for its end record
+  bool NextGame(ReplayGame *game);
+  // Feeds the inputs of the current game to session the same way the
+  // simulation thread does, after session has been started. Returns the
+  // number of steps. Throws GameError on a truncated or corrupt log.
+  Uint64 Play(GameSession *session);
+
+ private:
+  // Reads the input or end record at position, returns false at the end of
+  // the game with input->record set to kEnd or kGame
+  bool ReadInput(size_t *position, ReplayInput *input);
+  void Read(size_t *position, void *out, size_t size);
+  Uint32 ReadU32(size_t *position);
+  Uint64 ReadU64(size_t *position);
+  float ReadFloat(size_t *position);
+  Uint64 ReadVarint(size_t *position);
+
+  MappedFile file_;
+  // Start of the inputs of the current game and of the next game
+  size_t inputs_ = 0;
+  size_t next_game_ = 0;
+};
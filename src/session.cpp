@@ -0,0 +1,148 @@
+#include "session.h"
+
+#include <algorithm>
+
+#include "profiler.h"
+
+void GameSession::Seed(Uint64 seed) { seed_ = seed; }
+
+void GameSession::SetLookAhead(int blocks) {
+  look_ahead_ = std::max(blocks, 2);
+}
+
+void GameSession::SetParams(const SessionParams &params) {
+  params_ = params;
+}
+
+const SessionParams &GameSession::GetParams() { return params_; }
+
+void GameSession::SetLevelPrefetch(bool enabled) {
+  level_.SetPrefetch(enabled);
+}
+
+void GameSession::Start(int character_width, int character_height) {
+  blocks_.Init(look_ahead_ + 1);
+  camera_x_ = 0;
+  level_.Start(seed_);
+  for (int i = 0; i < look_ahead_; i++) {
+    GenNewBlock();
+  }
+  first_unhit_ = 1;
+
+  SDL_Rect character_box;
+  character_box.w = character_width;
+  character_box.h = character_height;
+  character_box.x = kCharacterPosition;
+  character_box.y = blocks_.Get(0).y - character_box.h;
+  physics_object_.Init(character_box);
+  physics_object_.ApplyForce(0, params_.gravity);
+  physics_object_.SetFriction(params_.friction_horizontal,
+                              params_.friction_vertical);
+  score_ = 0;
+  ended_ = false;
+}
+
+bool GameSession::Step(float relative_amplitude) {
+  // 振幅产生的速度按每秒kAmplitudeImpulseRate次施加，与步长无关
+  const float impulse_scale = params_.time_step * kAmplitudeImpulseRate;
+  const float vertical_speed = -relative_amplitude *
+                               params_.amplitude_to_vertical_speed *
+                               impulse_scale;
+  const float horizontal_speed = relative_amplitude *
+                                 params_.amplitude_to_horizontal_speed *
+                                 impulse_scale;
+  physics_object_.ApplyVelocity(horizontal_speed, vertical_speed);
+  HitDetectionResult r;
+  {
+    HAKUSYU_PROFILE_SCOPE(ProfileStage::kPhysics);
+    r = physics_object_.Update(blocks_, camera_x_, params_.time_step);
+  }
+  if (r.hit_lower_border || r.hit_upper_border) {
+    ended_ = true;
+  }
+  if (r.hit_block_id != -1) {
+    const Uint64 hit = blocks_.GetFrontSequence() + r.hit_block_id;
+    if (hit > first_unhit_) {
+      // 跳过了前面的方块
+      ended_ = true;
+      return false;
+    }
+    if (hit == first_unhit_) {
+      first_unhit_++;
+      score_++;
+    }
+  }
+  {
+    HAKUSYU_PROFILE_SCOPE(ProfileStage::kShiftBlocks);
+    ShiftBlocks(physics_object_.GetDeltaX());
+  }
+  return !ended_;
+}
+
+void GameSession::ApplyClap(float relative_strength) {
+  physics_object_.ApplyVelocity(
+      0.0f, -relative_strength * params_.amplitude_to_clap_speed);
+}
+
+void GameSession::ShiftBlocks(int pixels) {
+  if (blocks_.GetRight(0) - camera_x_ <= 0) {
+    GenNewBlock();
+    blocks_.PopFront();
+    // 没踩就滚出屏幕的方块不再要求补踩
+    first_unhit_ = std::max(first_unhit_, blocks_.GetFrontSequence());
+  }
+  camera_x_ += pixels;
+}
+
+bool GameSession::HasEnded() { return ended_; }
+
+float GameSession::GetTimeStep() { return params_.time_step; }
+
+int GameSession::GetScore() { return score_; }
+
+const BlockRing &GameSession::GetBlocks() { return blocks_; }
+
+int GameSession::GetCameraX() { return camera_x_; }
+
+bool GameSession::IsBlockHit(size_t i) {
+  return blocks_.GetFrontSequence() + i < first_unhit_;
+}
+
+PhysicsObject &GameSession::GetPhysicsObject() { return physics_object_; }
+
+void GameSession::FillSnapshot(WorldSnapshot *snapshot) {
+  snapshot->blocks.resize(blocks_.GetSize());
+  for (size_t i = 0; i < blocks_.GetSize(); i++) {
+    snapshot->blocks[i] = blocks_.Get(i);
+  }
+  snapshot->hit_blocks = static_cast<size_t>(
+      std::min<Uint64>(first_unhit_ - blocks_.GetFrontSequence(),
+                       blocks_.GetSize()));
+  snapshot->camera_x = camera_x_;
+  snapshot->character_box = physics_object_.GetBox();
+  snapshot->previous_character_y =
+      physics_object_.GetInterpolatedBox(0.0f).y;
+  snapshot->score = score_;
+  snapshot->ended = ended_;
+}
+
+void GameSession::GenNewBlock() {
+  const int block_width = static_cast<int>(kWindowWidth / division);
+
+  int offset = 0;
+  if (blocks_.GetSize() > 0) {
+    offset = blocks_.GetRight(blocks_.GetSize() - 1);
+  }
+  int width, height;
+  level_.NextBlock(&width, &height);
+  SDL_Rect block;
+  block.w = width;
+  block.h = height;
+  block.x = block_width - width + offset;
+  if (blocks_.GetSize() == 0) {
+    // 第一个方块放在角色脚下
+    block.x = kCharacterPosition + camera_x_;
+  }
+  block.y = kWindowHeight - block.h;
+  blocks_.PushBack(block);
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+#include <vector>
+
+#include "block_ring.h"
+#include "config.h"
+#include "level_generator.h"
+#include "physics.h"
+
+// 模拟线程发布给渲染线程的一局游戏的只读快照
+struct WorldSnapshot {
+  // World coordinates, subtract camera_x for the screen
+  std::vector<SDL_Rect> blocks;
+  // Blocks before this index have been hit
+  size_t hit_blocks = 0;
+  int camera_x = 0;
+  SDL_Rect character_box = {0, 0, 0, 0};
+  // Vertical position one step earlier, for render interpolation
+  int previous_character_y = 0;
+  // Clock time the newest step corresponds to
+  double time = 0.0;
+  float relative_amplitude = 0.0f;
+  // SDL_GetPerformanceCounter ticks for the latency tracer: callback of the
+  // newest audio chunk behind relative_amplitude, when it was read and when
+  // the steps that used it finished
+  Uint64 capture_timestamp = 0;
+  Uint64 amplitude_timestamp = 0;
+  Uint64 physics_timestamp = 0;
+  int score = 0;
+  bool ended = false;
+};
+
+// 可调的物理参数，默认值就是config.h里的常量
+struct SessionParams {
+  float amplitude_to_vertical_speed = kRelativeAmplitudeToVerticalSpeed;
+  float amplitude_to_horizontal_speed = kRelativeAmplitudeToHorizontalSpeed;
+  float amplitude_to_clap_speed = kRelativeAmplitudeToClapSpeed;
+  float friction_horizontal = kFrictionHorizontal;
+  float friction_vertical = kFrictionVertical;
+  float gravity = kGravity;
+  // 碰撞是扫掠检测，批量模拟可以用更大的步长换速度
+  float time_step = kPhysicsTimeStep;
+};
+
+// 一局游戏的全部逻辑状态，不依赖窗口和音频设备
+// Game drives it from the microphone, the headless runner from a synthetic
+// amplitude stream.
+class GameSession {
+ public:
+  // The same seed always produces the same level, takes effect on the next
+  // Start
+  void Seed(Uint64 seed);
+  // Number of blocks kept in flight, takes effect on the next Start
+  void SetLookAhead(int blocks);
+  // Takes effect on the next Start
+  void SetParams(const SessionParams &params);
+  const SessionParams &GetParams();
+  // See LevelGenerator::SetPrefetch, takes effect on the next Start
+  void SetLevelPrefetch(bool enabled);
+  void Start(int character_width, int character_height);
+  // Runs one fixed physics step of time_step seconds.
+  // Returns false once the game has ended.
+  bool Step(float relative_amplitude);
+  // One-off upward impulse, e.g. for a detected clap
+  void ApplyClap(float relative_strength);
+  // Scrolls the camera, O(1)
+  void ShiftBlocks(int pixels);
+  bool HasEnded();
+  float GetTimeStep();
+  int GetScore();
+  // Blocks are in world coordinates, subtract GetCameraX for the screen
+  const BlockRing &GetBlocks();
+  int GetCameraX();
+  bool IsBlockHit(size_t i);
+  PhysicsObject &GetPhysicsObject();
+  // Copies the state needed for drawing, reusing the storage of snapshot
+  void FillSnapshot(WorldSnapshot *snapshot);
+
+ private:
+  void GenNewBlock();
+
+  Uint64 seed_ = 0;
+  LevelGenerator level_;
+  BlockRing blocks_;
+  int camera_x_ = 0;
+  // 方块必须按顺序踩，所以已踩过的方块总是前缀，只需记住第一个没踩过的
+  Uint64 first_unhit_ = 0;
+  PhysicsObject physics_object_;
+  int look_ahead_ = kLookAheadBlocks;
+  SessionParams params_;
+  int score_ = 0;
+  bool ended_ = false;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+
+// x86的SIMD内核共用的检测宏，其他架构只编译标量版本
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+#define HAKUSYU_X86
+#include <immintrin.h>
+#endif
+
+// 各个模块选择SIMD路径时共用的CPU特性查询
+enum class SimdLevel {
+  kScalar,
+  kSSE2,
+};
+
+// The best level supported by this CPU, detected once at runtime
+inline SimdLevel GetSimdLevel() {
+  static const SimdLevel level = []() {
+#ifdef HAKUSYU_X86
+    if (SDL_HasSSE2()) {
+      return SimdLevel::kSSE2;
+    }
+#endif
+    return SimdLevel::kScalar;
+  }();
+  return level;
+}
@@ -0,0 +1,175 @@
+#include "text_renderer.h"
+
+#include <algorithm>
+#include <cstdarg>
+
+#include "game_error.h"
+
+void GlyphAtlas::Init(SDL_Renderer *renderer, TTF_Font *font,
+                      SDL_Color color) {
+  Rasterize(font, color);
+  Upload(renderer);
+}
+
+void GlyphAtlas::Rasterize(TTF_Font *font, SDL_Color color) {
+  // 异常退出时也要释放已经渲染出来的字形
+  struct GlyphSurfaces {
+    SDL_Surface *surfaces[kGlyphCount] = {};
+    ~GlyphSurfaces() {
+      for (SDL_Surface *surface : surfaces) {
+        SDL_FreeSurface(surface);
+      }
+    }
+  } holder;
+  SDL_Surface **glyphs = holder.surfaces;
+  int atlas_width = 0, atlas_height = 0, x = 0, y = 0, row_height = 0;
+  for (int i = 0; i < kGlyphCount; i++) {
+    const Uint16 ch = static_cast<Uint16>(kFirstGlyph + i);
+    glyphs[i] = TTF_RenderGlyph_Solid(font, ch, color);
+    if (glyphs[i] == nullptr) {
+      throw GameError(TTF_GetError());
+    }
+    int advance = glyphs[i]->w;
+    TTF_GlyphMetrics(font, ch, nullptr, nullptr, nullptr, nullptr, &advance);
+    advances_[i] = advance;
+
+    if (x + glyphs[i]->w > kMaxAtlasWidth) {
+      x = 0;
+      y += row_height;
+      row_height = 0;
+    }
+    glyph_rects_[i] = {x, y, glyphs[i]->w, glyphs[i]->h};
+    x += glyphs[i]->w;
+    row_height = std::max(row_height, glyphs[i]->h);
+    atlas_width = std::max(atlas_width, x);
+    atlas_height = std::max(atlas_height, y + row_height);
+  }
+  line_height_ = TTF_FontHeight(font);
+
+  SDL_Surface *atlas = SDL_CreateRGBSurfaceWithFormat(
+      0, atlas_width, atlas_height, 32, SDL_PIXELFORMAT_RGBA32);
+  if (atlas == nullptr) {
+    throw GameError(SDL_GetError());
+  }
+  SDL_FillRect(atlas, nullptr, SDL_MapRGBA(atlas->format, 0, 0, 0, 0));
+  for (int i = 0; i < kGlyphCount; i++) {
+    SDL_BlitSurface(glyphs[i], nullptr, atlas, &glyph_rects_[i]);
+  }
+  SDL_FreeSurface(surface_);
+  surface_ = atlas;
+}
+
+void GlyphAtlas::Upload(SDL_Renderer *renderer) {
+  texture_ = SDL_CreateTextureFromSurface(renderer, surface_);
+  SDL_FreeSurface(surface_);
+  surface_ = nullptr;
+  if (texture_ == nullptr) {
+    throw GameError(SDL_GetError());
+  }
+  SDL_SetTextureBlendMode(texture_, SDL_BLENDMODE_BLEND);
+}
+
+void GlyphAtlas::Destroy() {
+  SDL_FreeSurface(surface_);
+  surface_ = nullptr;
+  SDL_DestroyTexture(texture_);
+  texture_ = nullptr;
+}
+
+int GlyphAtlas::DrawText(RenderBatch *batch, const char *text, int x,
+                         int y) {
+  const int start = x;
+  for (const char *p = text; *p != '\0'; p++) {
+    const int i = static_cast<unsigned char>(*p) - kFirstGlyph;
+    if (i < 0 || i >= kGlyphCount) {
+      continue;
+    }
+    const SDL_Rect &source = glyph_rects_[i];
+    SDL_Rect target = {x, y, source.w, source.h};
+    batch->AddTexture(texture_, &source, target);
+    x += advances_[i];
+  }
+  return x - start;
+}
+
+int GlyphAtlas::GetLineHeight() { return line_height_; }
+
+SDL_Texture *GlyphAtlas::GetTexture() { return texture_; }
+
+TextLines::TextLines(std::initializer_list<const char *> lines) {
+  for (const char *line : lines) {
+    Add(line);
+  }
+}
+
+void TextLines::Clear() { size_ = 0; }
+
+void TextLines::Add(const char *line) { Format("%s", line); }
+
+void TextLines::Add(const TextLines &lines) {
+  for (int i = 0; i < lines.GetSize(); i++) {
+    Add(lines.Get(i));
+  }
+}
+
+void TextLines::Format(const char *format, ...) {
+  if (size_ == kMaxLines) {
+    return;
+  }
+  va_list args;
+  va_start(args, format);
+  SDL_vsnprintf(lines_[size_], kMaxLineLength, format, args);
+  va_end(args);
+  size_++;
+}
+
+int TextLines::GetSize() const { return size_; }
+
+const char *TextLines::Get(int i) const { return lines_[i]; }
+
+void TextTextureCache::Init(SDL_Renderer *renderer, TTF_Font *font,
+                            SDL_Color color, size_t capacity) {
+  renderer_ = renderer;
+  font_ = font;
+  color_ = color;
+  capacity_ = capacity;
+}
+
+void TextTextureCache::Clear() {
+  for (Entry &entry : entries_) {
+    SDL_DestroyTexture(entry.texture);
+  }
+  entries_.clear();
+  index_.clear();
+}
+
+std::tuple<SDL_Texture *, SDL_Rect> TextTextureCache::Get(const char *text) {
+  auto it = index_.find(text);
+  if (it != index_.end()) {
+    entries_.splice(entries_.begin(), entries_, it->second);
+    return std::make_tuple(it->second->texture, it->second->size);
+  }
+
+  // TTF拒绝渲染空字符串，用一个空格代替
+  SDL_Surface *s =
+      TTF_RenderText_Solid(font_, text[0] == '\0' ? " " : text, color_);
+  if (s == nullptr) {
+    throw GameError(TTF_GetError());
+  }
+  SDL_Texture *t = SDL_CreateTextureFromSurface(renderer_, s);
+  if (t == nullptr) {
+    SDL_FreeSurface(s);
+    throw GameError(SDL_GetError());
+  }
+  SDL_Rect size = {0, 0, s->w, s->h};
+  SDL_FreeSurface(s);
+
+  if (entries_.size() >= capacity_ && !entries_.empty()) {
+    SDL_DestroyTexture(entries_.back().texture);
+    index_.erase(entries_.back().text);
+    entries_.pop_back();
+  }
+  entries_.push_front({text, t, size});
+  index_[entries_.front().text] = entries_.begin();
+  return std::make_tuple(t, size);
+}
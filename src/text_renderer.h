@@ -0,0 +1,92 @@
+#pragma once
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_ttf.h>
+
+#include <initializer_list>
+#include <list>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <unordered_map>
+
+#include "render_batch.h"
+
+// 预先栅格化好的ASCII字形图集，每帧的动态文字和其他图形一起批量提交
+class GlyphAtlas {
+ public:
+  void Init(SDL_Renderer *renderer, TTF_Font *font, SDL_Color color);
+  // CPU half of Init, may run on a loading thread as long as nothing else
+  // uses font meanwhile
+  void Rasterize(TTF_Font *font, SDL_Color color);
+  // Render thread, turns the rasterized glyphs into the atlas texture
+  void Upload(SDL_Renderer *renderer);
+  void Destroy();
+  // Adds the glyph quads to batch and returns the width of the text.
+  // Characters outside the atlas are skipped.
+  int DrawText(RenderBatch *batch, const char *text, int x, int y);
+  int GetLineHeight();
+  SDL_Texture *GetTexture();
+
+ private:
+  static constexpr int kFirstGlyph = 32;
+  static constexpr int kLastGlyph = 126;
+  static constexpr int kGlyphCount = kLastGlyph - kFirstGlyph + 1;
+  static constexpr int kMaxAtlasWidth = 1024;
+
+  SDL_Texture *texture_ = nullptr;
+  // Between Rasterize and Upload
+  SDL_Surface *surface_ = nullptr;
+  SDL_Rect glyph_rects_[kGlyphCount];
+  int advances_[kGlyphCount];
+  int line_height_ = 0;
+};
+
+// 定长的多行文字，拼提示页面时不分配堆内存
+class TextLines {
+ public:
+  static constexpr int kMaxLines = 16;
+  static constexpr int kMaxLineLength = 96;
+
+  TextLines() = default;
+  TextLines(std::initializer_list<const char *> lines);
+  void Clear();
+  // Lines beyond kMaxLines are dropped and long lines are truncated
+  void Add(const char *line);
+  void Add(const TextLines &lines);
+  // Adds one printf-style line
+  void Format(const char *format, ...);
+  int GetSize() const;
+  const char *Get(int i) const;
+
+ private:
+  char lines_[kMaxLines][kMaxLineLength];
+  int size_ = 0;
+};
+
+// 整行文字纹理的LRU缓存，用于静态的提示页面
+class TextTextureCache {
+ public:
+  void Init(SDL_Renderer *renderer, TTF_Font *font, SDL_Color color,
+            size_t capacity);
+  void Clear();
+  // The texture stays owned by the cache and is valid until it is evicted.
+  // Only a miss allocates.
+  std::tuple<SDL_Texture *, SDL_Rect> Get(const char *text);
+
+ private:
+  struct Entry {
+    std::string text;
+    SDL_Texture *texture;
+    SDL_Rect size;
+  };
+
+  SDL_Renderer *renderer_ = nullptr;
+  TTF_Font *font_ = nullptr;
+  SDL_Color color_;
+  size_t capacity_ = 0;
+  // Most recently used first
+  std::list<Entry> entries_;
+  // Keys view the text of the entries, list nodes never move
+  std::unordered_map<std::string_view, std::list<Entry>::iterator> index_;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+// 单写者单读者的无锁三缓冲，读者总是拿到最新发布的完整数据
+// The writer fills the back buffer and publishes it by swapping it with the
+// shared middle slot, the reader swaps the middle slot with its front buffer
+// when something new was published. Neither side ever waits for the other,
+// snapshots the reader did not pick up in time are simply overwritten.
+template <typename T>
+class TripleBuffer {
+ public:
+  // Writer side
+  T &GetBackBuffer() { return buffers_[back_]; }
+
+  // Writer side
+  void Publish() {
+    const int old =
+        middle_.exchange(back_ | kFreshBit, std::memory_order_acq_rel);
+    back_ = old & kIndexMask;
+  }
+
+  // Reader side. Returns true if a newer buffer became the front buffer.
+  bool Update() {
+    if ((middle_.load(std::memory_order_relaxed) & kFreshBit) == 0) {
+      return false;
+    }
+    const int old = middle_.exchange(front_, std::memory_order_acq_rel);
+    front_ = old & kIndexMask;
+    return true;
+  }
+
+  // Reader side
+  const T &GetFrontBuffer() const { return buffers_[front_]; }
+
+ private:
+  static constexpr int kIndexMask = 3;
+  static constexpr int kFreshBit = 4;
+
+  std::array<T, 3> buffers_;
+  int front_ = 0;
+  alignas(64) std::atomic<int> middle_{1};
+  alignas(64) int back_ = 2;
+};
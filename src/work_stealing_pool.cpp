@@ -0,0 +1,135 @@
+#include "work_stealing_pool.h"
+
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool(int threads) {
+  if (threads <= 0) {
+    threads = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  thread_count_ = std::max(threads, 1);
+  queues_ = std::make_unique<Queue[]>(thread_count_);
+  for (int i = 1; i < thread_count_; i++) {
+    threads_.emplace_back(&WorkStealingPool::WorkerMain, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  start_.notify_all();
+  for (std::thread &thread : threads_) {
+    thread.join();
+  }
+}
+
+int WorkStealingPool::GetThreadCount() const { return thread_count_; }
+
+void WorkStealingPool::ParallelFor(
+    size_t count, const std::function<void(size_t, int)> &task) {
+  if (count == 0) {
+    return;
+  }
+  // 先平均分好，偷取只用来吸收各任务耗时的差别
+  for (int i = 0; i < thread_count_; i++) {
+    std::lock_guard<std::mutex> lock(queues_[i].mutex);
+    queues_[i].begin = count * i / thread_count_;
+    queues_[i].end = count * (i + 1) / thread_count_;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    error_ = nullptr;
+    busy_workers_ = thread_count_;
+    generation_++;
+  }
+  start_.notify_all();
+
+  Work(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  done_.wait(lock, [this] { return busy_workers_ == 0; });
+  task_ = nullptr;
+  if (error_ != nullptr) {
+    std::rethrow_exception(error_);
+  }
+}
+
+void WorkStealingPool::WorkerMain(int worker) {
+  unsigned long long seen_generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      start_.wait(lock, [&] {
+        return stopping_ || generation_ != seen_generation;
+      });
+      if (stopping_) {
+        return;
+      }
+      seen_generation = generation_;
+    }
+    Work(worker);
+  }
+}
+
+void WorkStealingPool::Work(int worker) {
+  const std::function<void(size_t, int)> *task;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task = task_;
+  }
+  size_t index;
+  while (Pop(worker, &index) || Steal(worker, &index)) {
+    try {
+      (*task)(index, worker);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (error_ == nullptr) {
+        error_ = std::current_exception();
+      }
+    }
+  }
+  // 任务不会产生新任务，所有队列都空了就可以结束
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (--busy_workers_ == 0) {
+    done_.notify_one();
+  }
+}
+
+bool WorkStealingPool::Pop(int worker, size_t *index) {
+  Queue &queue = queues_[worker];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.begin == queue.end) {
+    return false;
+  }
+  *index = queue.begin++;
+  return true;
+}
+
+bool WorkStealingPool::Steal(int worker, size_t *index) {
+  for (int i = 1; i < thread_count_; i++) {
+    Queue &victim = queues_[(worker + i) % thread_count_];
+    size_t begin, end;
+    {
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      const size_t remaining = victim.end - victim.begin;
+      if (remaining == 0) {
+        continue;
+      }
+      // 偷走后一半，至少一个
+      begin = victim.end - (remaining + 1) / 2;
+      end = victim.end;
+      victim.end = begin;
+    }
+    *index = begin;
+    if (begin + 1 < end) {
+      Queue &queue = queues_[worker];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.begin = begin + 1;
+      queue.end = end;
+    }
+    return true;
+  }
+  return false;
+}
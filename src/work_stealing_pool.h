@@ -0,0 +1,57 @@
+#pragma once
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// 固定数量的工作线程，每个线程有自己的任务区间，做完了就从别的线程偷一半
+// Tasks are indices, so a queue is just a range and a steal moves the upper
+// half of the victim's range. That keeps the memory each worker touches
+// mostly contiguous and the locks rarely contended.
+class WorkStealingPool {
+ public:
+  // 0 threads means one per hardware thread
+  explicit WorkStealingPool(int threads = 0);
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+  ~WorkStealingPool();
+
+  // Including the thread that calls ParallelFor
+  int GetThreadCount() const;
+  // Runs task(index, worker) for every index in [0, count) and returns when
+  // all are done. worker is in [0, GetThreadCount()), the caller is worker 0.
+  // The first exception thrown by a task is rethrown here.
+  void ParallelFor(size_t count,
+                   const std::function<void(size_t, int)> &task);
+
+ private:
+  // 每个队列独占一个缓存行，避免伪共享
+  struct alignas(64) Queue {
+    std::mutex mutex;
+    size_t begin = 0;
+    size_t end = 0;
+  };
+
+  void WorkerMain(int worker);
+  // Runs tasks until every queue is empty
+  void Work(int worker);
+  bool Pop(int worker, size_t *index);
+  bool Steal(int worker, size_t *index);
+
+  int thread_count_;
+  std::unique_ptr<Queue[]> queues_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable start_;
+  std::condition_variable done_;
+  // Guarded by mutex_
+  const std::function<void(size_t, int)> *task_ = nullptr;
+  unsigned long long generation_ = 0;
+  int busy_workers_ = 0;
+  bool stopping_ = false;
+  std::exception_ptr error_;
+};